@@ -0,0 +1,311 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "ByteBuffer.h"
+#include "BitStream.h"
+
+#include <random>
+
+// Primitive append/read, the range is the number of values per buffer
+
+template <typename T>
+static void BM_AppendPrimitive(benchmark::State& state)
+{
+    size_t count = size_t(state.range(0));
+    for (auto _ : state)
+    {
+        ByteBuffer buffer;
+        for (size_t i = 0; i < count; ++i)
+            buffer << T(i);
+        benchmark::DoNotOptimize(buffer.contents());
+    }
+    state.SetBytesProcessed(int64(state.iterations()) * count * sizeof(T));
+}
+BENCHMARK_TEMPLATE(BM_AppendPrimitive, uint8)->Arg(16)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_AppendPrimitive, uint32)->Arg(16)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_AppendPrimitive, uint64)->Arg(16)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_AppendPrimitive, float)->Arg(16)->Arg(1024);
+
+template <typename T>
+static void BM_ReadPrimitive(benchmark::State& state)
+{
+    size_t count = size_t(state.range(0));
+    ByteBuffer buffer;
+    for (size_t i = 0; i < count; ++i)
+        buffer << T(i);
+
+    for (auto _ : state)
+    {
+        buffer.rpos(0);
+        for (size_t i = 0; i < count; ++i)
+            benchmark::DoNotOptimize(buffer.read<T>());
+    }
+    state.SetBytesProcessed(int64(state.iterations()) * count * sizeof(T));
+}
+BENCHMARK_TEMPLATE(BM_ReadPrimitive, uint8)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_ReadPrimitive, uint32)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_ReadPrimitive, uint64)->Arg(1024);
+BENCHMARK_TEMPLATE(BM_ReadPrimitive, float)->Arg(1024);
+
+// Strings, the range is the string length
+
+static void BM_AppendString(benchmark::State& state)
+{
+    std::string value(size_t(state.range(0)), 'x');
+    for (auto _ : state)
+    {
+        ByteBuffer buffer;
+        for (int i = 0; i < 16; ++i)
+            buffer << value;
+        benchmark::DoNotOptimize(buffer.contents());
+    }
+    state.SetBytesProcessed(int64(state.iterations()) * 16 * value.size());
+}
+BENCHMARK(BM_AppendString)->Arg(8)->Arg(64)->Arg(512);
+
+static void BM_ReadString(benchmark::State& state)
+{
+    std::string value(size_t(state.range(0)), 'x');
+    ByteBuffer buffer;
+    for (int i = 0; i < 16; ++i)
+        buffer << value;
+
+    std::string result;
+    for (auto _ : state)
+    {
+        buffer.rpos(0);
+        for (int i = 0; i < 16; ++i)
+        {
+            buffer >> result;
+            benchmark::DoNotOptimize(result.data());
+        }
+    }
+    state.SetBytesProcessed(int64(state.iterations()) * 16 * value.size());
+}
+BENCHMARK(BM_ReadString)->Arg(8)->Arg(64)->Arg(512);
+
+// Bit packing, 11 bit fields through every available path
+
+static void BM_WriteBit(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        ByteBuffer buffer;
+        for (uint32 i = 0; i < 256; ++i)
+            for (int bit = 10; bit >= 0; --bit)
+                buffer.WriteBit((i >> bit) & 1);
+        buffer.FlushBits();
+        benchmark::DoNotOptimize(buffer.contents());
+    }
+    state.SetItemsProcessed(int64(state.iterations()) * 256);
+}
+BENCHMARK(BM_WriteBit);
+
+static void BM_WriteBits(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        ByteBuffer buffer;
+        for (uint32 i = 0; i < 256; ++i)
+            buffer.WriteBits(i, 11);
+        buffer.FlushBits();
+        benchmark::DoNotOptimize(buffer.contents());
+    }
+    state.SetItemsProcessed(int64(state.iterations()) * 256);
+}
+BENCHMARK(BM_WriteBits);
+
+static void BM_BitWriter(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        ByteBuffer buffer;
+        {
+            BitWriter bits(buffer);
+            for (uint32 i = 0; i < 256; ++i)
+                bits.Write(i, 11);
+        }
+        benchmark::DoNotOptimize(buffer.contents());
+    }
+    state.SetItemsProcessed(int64(state.iterations()) * 256);
+}
+BENCHMARK(BM_BitWriter);
+
+static void BM_ReadBits(benchmark::State& state)
+{
+    ByteBuffer buffer;
+    for (uint32 i = 0; i < 256; ++i)
+        buffer.WriteBits(i, 11);
+    buffer.FlushBits();
+
+    for (auto _ : state)
+    {
+        buffer.rpos(0);
+        buffer.ResetBitPos();
+        for (uint32 i = 0; i < 256; ++i)
+            benchmark::DoNotOptimize(buffer.ReadBits(11));
+    }
+    state.SetItemsProcessed(int64(state.iterations()) * 256);
+}
+BENCHMARK(BM_ReadBits);
+
+static void BM_BitReader(benchmark::State& state)
+{
+    ByteBuffer buffer;
+    {
+        BitWriter bits(buffer);
+        for (uint32 i = 0; i < 256; ++i)
+            bits.Write(i, 11);
+    }
+
+    for (auto _ : state)
+    {
+        buffer.rpos(0);
+        BitReader bits(buffer);
+        for (uint32 i = 0; i < 256; ++i)
+            benchmark::DoNotOptimize(bits.Read(11));
+    }
+    state.SetItemsProcessed(int64(state.iterations()) * 256);
+}
+BENCHMARK(BM_BitReader);
+
+// Varints, the range is the number of significant bits of the values
+
+static void BM_AppendVarUInt(benchmark::State& state)
+{
+    uint64 value = (uint64(1) << (state.range(0) - 1)) | 1;
+    for (auto _ : state)
+    {
+        ByteBuffer buffer;
+        for (int i = 0; i < 256; ++i)
+            buffer.AppendVarUInt(value);
+        benchmark::DoNotOptimize(buffer.contents());
+    }
+    state.SetItemsProcessed(int64(state.iterations()) * 256);
+}
+BENCHMARK(BM_AppendVarUInt)->Arg(7)->Arg(28)->Arg(64);
+
+static void BM_ReadVarUInt(benchmark::State& state)
+{
+    uint64 value = (uint64(1) << (state.range(0) - 1)) | 1;
+    ByteBuffer buffer;
+    for (int i = 0; i < 256; ++i)
+        buffer.AppendVarUInt(value);
+
+    for (auto _ : state)
+    {
+        buffer.rpos(0);
+        for (int i = 0; i < 256; ++i)
+            benchmark::DoNotOptimize(buffer.ReadVarUInt());
+    }
+    state.SetItemsProcessed(int64(state.iterations()) * 256);
+}
+BENCHMARK(BM_ReadVarUInt)->Arg(7)->Arg(28)->Arg(64);
+
+// Containers, the range is the number of elements
+
+static void BM_AppendVector(benchmark::State& state)
+{
+    std::vector<uint32> values(size_t(state.range(0)), 0x01020304);
+    for (auto _ : state)
+    {
+        ByteBuffer buffer;
+        buffer << values;
+        benchmark::DoNotOptimize(buffer.contents());
+    }
+    state.SetBytesProcessed(int64(state.iterations()) * values.size() * sizeof(uint32));
+}
+BENCHMARK(BM_AppendVector)->Arg(16)->Arg(4096);
+
+static void BM_ReadVector(benchmark::State& state)
+{
+    std::vector<uint32> values(size_t(state.range(0)), 0x01020304);
+    ByteBuffer buffer;
+    buffer << values;
+
+    std::vector<uint32> result;
+    for (auto _ : state)
+    {
+        buffer.rpos(0);
+        buffer >> result;
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.SetBytesProcessed(int64(state.iterations()) * values.size() * sizeof(uint32));
+}
+BENCHMARK(BM_ReadVector)->Arg(16)->Arg(4096);
+
+// Position packing, the range is the fleet size
+
+struct Positions
+{
+    explicit Positions(size_t count) : x(count), y(count), z(count)
+    {
+        std::mt19937 rng(count);
+        std::uniform_real_distribution<float> coord(-255.0f, 255.0f);
+        for (size_t i = 0; i < count; ++i)
+        {
+            x[i] = coord(rng);
+            y[i] = coord(rng);
+            z[i] = coord(rng) / 2;
+        }
+    }
+
+    std::vector<float> x, y, z;
+};
+
+static void BM_AppendPackXYZ(benchmark::State& state)
+{
+    Positions positions(size_t(state.range(0)));
+    for (auto _ : state)
+    {
+        ByteBuffer buffer;
+        for (size_t i = 0; i < positions.x.size(); ++i)
+            buffer.appendPackXYZ(positions.x[i], positions.y[i], positions.z[i]);
+        benchmark::DoNotOptimize(buffer.contents());
+    }
+    state.SetItemsProcessed(int64(state.iterations()) * positions.x.size());
+}
+BENCHMARK(BM_AppendPackXYZ)->Arg(64)->Arg(4096);
+
+static void BM_AppendPackXYZBatch(benchmark::State& state)
+{
+    Positions positions(size_t(state.range(0)));
+    for (auto _ : state)
+    {
+        ByteBuffer buffer;
+        buffer.appendPackXYZ(positions.x.data(), positions.y.data(), positions.z.data(), positions.x.size());
+        benchmark::DoNotOptimize(buffer.contents());
+    }
+    state.SetItemsProcessed(int64(state.iterations()) * positions.x.size());
+}
+BENCHMARK(BM_AppendPackXYZBatch)->Arg(64)->Arg(4096);
+
+static void BM_ReadPackXYZBatch(benchmark::State& state)
+{
+    Positions positions(size_t(state.range(0)));
+    ByteBuffer buffer;
+    buffer.appendPackXYZ(positions.x.data(), positions.y.data(), positions.z.data(), positions.x.size());
+
+    for (auto _ : state)
+    {
+        buffer.rpos(0);
+        buffer.readPackXYZ(positions.x.data(), positions.y.data(), positions.z.data(), positions.x.size());
+        benchmark::DoNotOptimize(positions.x.data());
+    }
+    state.SetItemsProcessed(int64(state.iterations()) * positions.x.size());
+}
+BENCHMARK(BM_ReadPackXYZBatch)->Arg(64)->Arg(4096);
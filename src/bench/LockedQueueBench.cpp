@@ -0,0 +1,115 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "Packet.h"
+#include "LockedQueue.h"
+#include "SPSCQueue.h"
+
+// Shared by all threads of a run, the same way a session queue is shared by network and world threads
+static LockedQueue<Packet*> Queue;
+
+// Every thread pushes and pops, the range of thread counts shows lock contention
+static void BM_LockedQueueAddNext(benchmark::State& state)
+{
+    Packet packet(1);
+    Packet* result = nullptr;
+    for (auto _ : state)
+    {
+        Queue.add(&packet);
+        benchmark::DoNotOptimize(Queue.next(result));
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    // nothing may be left over for the next run
+    if (state.thread_index() == 0)
+        while (Queue.next(result)) { }
+}
+BENCHMARK(BM_LockedQueueAddNext)->ThreadRange(1, 8)->UseRealTime();
+
+// Producers on odd threads, one consumer polling on thread 0, like network threads feeding a session
+static void BM_LockedQueueProducerConsumer(benchmark::State& state)
+{
+    Packet packet(1);
+    Packet* result = nullptr;
+    int64 consumed = 0;
+    for (auto _ : state)
+    {
+        if (state.thread_index() == 0)
+            consumed += Queue.next(result) ? 1 : 0;
+        else
+            Queue.add(&packet);
+    }
+
+    if (state.thread_index() == 0)
+    {
+        state.counters["consumed"] = double(consumed);
+        while (Queue.next(result)) { }
+    }
+    else
+        state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LockedQueueProducerConsumer)->ThreadRange(2, 8)->UseRealTime();
+
+// Same, the consumer taking everything queued under one lock the way UpdateSessions takes new sessions
+static void BM_LockedQueueProducerDrain(benchmark::State& state)
+{
+    Packet packet(1);
+    LockedQueue<Packet*>::storage_type drained;
+    int64 consumed = 0;
+    for (auto _ : state)
+    {
+        if (state.thread_index() == 0)
+            consumed += Queue.drain(drained) ? int64(drained.size()) : 0;
+        else
+            Queue.add(&packet);
+    }
+
+    if (state.thread_index() == 0)
+    {
+        state.counters["consumed"] = double(consumed);
+        Queue.drain(drained);
+    }
+    else
+        state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LockedQueueProducerDrain)->ThreadRange(2, 8)->UseRealTime();
+
+// The session receive queue: one network thread producing, the update consuming in batches
+static SPSCQueue<Packet*> RecvQueue(1024);
+
+static void BM_SPSCQueueProducerConsumer(benchmark::State& state)
+{
+    Packet packet(1);
+    int64 moved = 0;
+    for (auto _ : state)
+    {
+        if (state.thread_index() == 0)
+            moved += int64(RecvQueue.drain([](Packet* item) -> bool { benchmark::DoNotOptimize(item); return true; }));
+        else
+            moved += RecvQueue.add(&packet) ? 1 : 0;
+    }
+
+    if (state.thread_index() == 0)
+    {
+        state.counters["consumed"] = double(moved);
+        Packet* result = nullptr;
+        while (RecvQueue.next(result)) { }
+    }
+    else
+        state.SetItemsProcessed(moved);
+}
+BENCHMARK(BM_SPSCQueueProducerConsumer)->Threads(2)->UseRealTime();
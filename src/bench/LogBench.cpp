@@ -0,0 +1,76 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <benchmark/benchmark.h>
+
+#include "Log.h"
+
+#include <string>
+
+// The formatter runs and discards its output, what is measured is the cost on the logging thread.
+// The ring is drained untimed each time it could be full, so no iteration takes the drop path.
+static void BM_LogInfo(benchmark::State& state)
+{
+    sLog->Start(nullptr);
+
+    std::string address = "127.0.0.1";
+    uint32 account = 42;
+    size_t queued = 0;
+    for (auto _ : state)
+    {
+        LOG_INFO("session", "Session::QueuePacket: client {} (account {}) overflowed its receive queue, kicking", address, account);
+
+        if (++queued == Log::THREAD_QUEUE_SIZE)
+        {
+            state.PauseTiming();
+            sLog->WaitForRoom(Log::THREAD_QUEUE_SIZE);
+            state.ResumeTiming();
+            queued = 0;
+        }
+    }
+
+    if (state.thread_index() == 0)
+    {
+        sLog->Stop();
+        state.counters["dropped"] = double(sLog->GetDroppedCount());
+    }
+}
+BENCHMARK(BM_LogInfo)->ThreadRange(1, 4);
+
+// Below LOG_MIN_LEVEL the call is compiled out
+static void BM_LogCompiledOut(benchmark::State& state)
+{
+    uint32 account = 42;
+    for (auto _ : state)
+    {
+        LOG_TRACE("session", "account {}", account);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_LogCompiledOut);
+
+// Filtered by the runtime level, one relaxed load
+static void BM_LogFilteredOut(benchmark::State& state)
+{
+    sLog->SetLevel(LOG_LEVEL_ERROR);
+
+    uint32 account = 42;
+    for (auto _ : state)
+        LOG_INFO("session", "account {}", account);
+
+    sLog->SetLevel(LOG_LEVEL_TRACE);
+}
+BENCHMARK(BM_LogFilteredOut);
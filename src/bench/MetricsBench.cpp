@@ -0,0 +1,51 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <benchmark/benchmark.h>
+
+#include "Metrics.h"
+
+// What a network thread pays per read for ships_network_received_bytes_total
+static void BM_MetricCounterAdd(benchmark::State& state)
+{
+    static MetricCounter& counter = sMetrics->GetCounter("bench_counter_total", "Bench counter");
+    for (auto _ : state)
+        counter.Add(64);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MetricCounterAdd)->ThreadRange(1, 8)->UseRealTime();
+
+// Per statement in MySQLConnection, each thread into its own shard
+static void BM_MetricHistogramRecord(benchmark::State& state)
+{
+    static MetricHistogram& histogram = sMetrics->GetHistogram("bench_histogram_seconds", "Bench histogram");
+    uint64 value = 1000;
+    for (auto _ : state)
+        histogram.Record(value++);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MetricHistogramRecord)->ThreadRange(1, 8)->UseRealTime();
+
+// A scrape, off the world thread
+static void BM_MetricsRender(benchmark::State& state)
+{
+    for (int i = 0; i < 32; ++i)
+        sMetrics->GetCounter(("bench_render_" + std::to_string(i) + "_total").c_str(), "Bench counter").Add();
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(sMetrics->Render());
+}
+BENCHMARK(BM_MetricsRender);
@@ -0,0 +1,177 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "Packet.h"
+#include "MessageBuffer.h"
+#include "PacketFramer.h"
+
+// READ_BLOCK_SIZE of Socket.h, which would pull in asio
+static size_t const ReadBlockSize = 4096;
+
+// Stands in for Socket: accepts every header and turns the payload into a Packet the same way
+struct CountingSink
+{
+    CountingSink() : Packets(0) { }
+
+    bool ReadHeaderHandler(ClientHeader const& header)
+    {
+        return ClientHeader::IsValidSize(header.Size);
+    }
+
+    bool ReadDataHandler(ClientHeader const& header, MessageBuffer& payload)
+    {
+        Packet packet(header.Command, std::move(payload));
+        benchmark::DoNotOptimize(packet.contents());
+        ++Packets;
+        return true;
+    }
+
+    size_t Packets;
+};
+
+// count client packets with payloadSize bytes each, back to back
+static std::vector<uint8> MakeStream(size_t count, size_t payloadSize)
+{
+    std::vector<uint8> stream;
+    for (size_t i = 0; i < count; ++i)
+    {
+        ClientHeader header;
+        header.Command = 1;
+        header.Size = uint16(payloadSize);
+
+        uint8 const* raw = reinterpret_cast<uint8 const*>(&header);
+        stream.insert(stream.end(), raw, raw + sizeof(header));
+        stream.insert(stream.end(), payloadSize, uint8(i));
+    }
+
+    return stream;
+}
+
+// Feeds the stream in reads of at most chunkSize bytes, the way ReadHandler gets it from the socket
+static void FeedStream(benchmark::State& state, size_t payloadSize, size_t chunkSize)
+{
+    size_t const count = 64;
+    std::vector<uint8> stream = MakeStream(count, payloadSize);
+    MessageBuffer readBuffer(ReadBlockSize);
+
+    for (auto _ : state)
+    {
+        PacketFramer framer;
+        CountingSink sink;
+        for (size_t offset = 0; offset < stream.size(); offset += chunkSize)
+        {
+            size_t bytes = std::min(chunkSize, stream.size() - offset);
+            readBuffer.Reset();
+            readBuffer.Write(&stream[offset], bytes);
+            framer.Process(readBuffer, sink);
+        }
+
+        if (sink.Packets != count)
+            state.SkipWithError("framing lost packets");
+    }
+    state.SetItemsProcessed(int64(state.iterations()) * count);
+    state.SetBytesProcessed(int64(state.iterations()) * stream.size());
+}
+
+// Many small packets coalesced into full reads, the range is the payload size
+static void BM_FrameCoalesced(benchmark::State& state)
+{
+    FeedStream(state, size_t(state.range(0)), ReadBlockSize);
+}
+BENCHMARK(BM_FrameCoalesced)->Arg(8)->Arg(48)->Arg(256);
+
+// Packets split over several reads, the range is the read size
+static void BM_FrameSplit(benchmark::State& state)
+{
+    FeedStream(state, 256, size_t(state.range(0)));
+}
+BENCHMARK(BM_FrameSplit)->Arg(3)->Arg(100)->Arg(1000);
+
+// Packet building and the two send paths
+
+static void BuildPacket(Packet& packet)
+{
+    packet << uint32(1) << uint32(2) << uint64(3);
+    packet << float(1.0f) << float(2.0f) << float(3.0f);
+    packet << std::string("ShipsInc");
+}
+
+static void BM_BuildPacket(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        Packet packet(1);
+        BuildPacket(packet);
+        benchmark::DoNotOptimize(packet.contents());
+    }
+}
+BENCHMARK(BM_BuildPacket);
+
+// Socket::SendPacket(Packet&&): header written in place, storage moved to the write queue
+static void BM_SendPacketMove(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        Packet packet(1);
+        BuildPacket(packet);
+        MessageBuffer buffer(packet.MoveWithHeader());
+        benchmark::DoNotOptimize(buffer.GetReadPointer());
+    }
+}
+BENCHMARK(BM_SendPacketMove);
+
+// Socket::SendPacket(Packet const&): header and payload copied into a new MessageBuffer
+static void BM_SendPacketCopy(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        Packet packet(1);
+        BuildPacket(packet);
+
+        ServerHeader header;
+        header.Size = uint16(packet.size());
+        header.Command = packet.GetOpcode();
+
+        MessageBuffer buffer(sizeof(header) + packet.size());
+        buffer.Write(&header, sizeof(header));
+        buffer.Write(packet.contents(), packet.size());
+        benchmark::DoNotOptimize(buffer.GetReadPointer());
+    }
+}
+BENCHMARK(BM_SendPacketCopy);
+
+// MessageBuffer as the socket read buffer: partial consume, Normalize, refill
+static void BM_MessageBufferNormalize(benchmark::State& state)
+{
+    std::vector<uint8> chunk(size_t(state.range(0)), 0xAB);
+    MessageBuffer buffer(ReadBlockSize);
+
+    for (auto _ : state)
+    {
+        buffer.Reset();
+        for (int i = 0; i < 16; ++i)
+        {
+            buffer.Normalize();
+            buffer.EnsureFreeSpace();
+            buffer.Write(chunk.data(), std::min(chunk.size(), buffer.GetRemainingSpace()));
+            buffer.ReadCompleted(buffer.GetActiveSize() / 2);
+        }
+        benchmark::DoNotOptimize(buffer.GetReadPointer());
+    }
+    state.SetBytesProcessed(int64(state.iterations()) * 16 * chunk.size());
+}
+BENCHMARK(BM_MessageBufferNormalize)->Arg(64)->Arg(1024);
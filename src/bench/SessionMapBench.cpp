@@ -0,0 +1,147 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "SlotMap.h"
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+
+// Stands in for Session: heap allocated one by one, a timer to update per tick
+struct BenchSession
+{
+    explicit BenchSession(uint32 id) : AccountId(id), TimeOut(30000) { }
+
+    bool Update(uint32 diff)
+    {
+        TimeOut -= int32(diff);
+        return TimeOut > 0;
+    }
+
+    uint32 AccountId;
+    int32 TimeOut;
+};
+
+// account ids are not handed out in order, so neither map gets a sorted insert
+static std::vector<uint32> MakeAccountIds(size_t count)
+{
+    std::vector<uint32> ids(count);
+    for (size_t i = 0; i < count; ++i)
+        ids[i] = uint32(i + 1);
+
+    std::shuffle(ids.begin(), ids.end(), std::mt19937(42));
+    return ids;
+}
+
+// Server::UpdateSessions before: walk of std::unordered_map<uint32, Session*>
+static void BM_SessionTickUnorderedMap(benchmark::State& state)
+{
+    std::vector<uint32> ids = MakeAccountIds(size_t(state.range(0)));
+    std::unordered_map<uint32, BenchSession*> sessions;
+    for (uint32 id : ids)
+        sessions[id] = new BenchSession(id);
+
+    for (auto _ : state)
+    {
+        for (std::unordered_map<uint32, BenchSession*>::iterator itr = sessions.begin(); itr != sessions.end(); ++itr)
+            benchmark::DoNotOptimize(itr->second->Update(0));
+    }
+    state.SetItemsProcessed(int64(state.iterations()) * sessions.size());
+
+    for (std::unordered_map<uint32, BenchSession*>::iterator itr = sessions.begin(); itr != sessions.end(); ++itr)
+        delete itr->second;
+}
+BENCHMARK(BM_SessionTickUnorderedMap)->Arg(1000)->Arg(100000);
+
+// Server::UpdateSessions now: dense walk of SlotMap<Session*>
+static void BM_SessionTickSlotMap(benchmark::State& state)
+{
+    std::vector<uint32> ids = MakeAccountIds(size_t(state.range(0)));
+    SlotMap<BenchSession*> sessions;
+    for (uint32 id : ids)
+        sessions.Insert(new BenchSession(id));
+
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < sessions.size(); ++i)
+            benchmark::DoNotOptimize(sessions[i]->Update(0));
+    }
+    state.SetItemsProcessed(int64(state.iterations()) * sessions.size());
+
+    for (BenchSession* session : sessions)
+        delete session;
+}
+BENCHMARK(BM_SessionTickSlotMap)->Arg(1000)->Arg(100000);
+
+// Lookup by account id through the index, then by handle
+static void BM_SessionFindSlotMap(benchmark::State& state)
+{
+    std::vector<uint32> ids = MakeAccountIds(size_t(state.range(0)));
+    SlotMap<BenchSession*> sessions;
+    std::unordered_map<uint32, SlotMap<BenchSession*>::Handle> byAccount;
+    for (uint32 id : ids)
+        byAccount[id] = sessions.Insert(new BenchSession(id));
+
+    size_t next = 0;
+    for (auto _ : state)
+    {
+        BenchSession** session = sessions.Find(byAccount[ids[next]]);
+        benchmark::DoNotOptimize(session);
+        next = (next + 1) % ids.size();
+    }
+
+    for (BenchSession* session : sessions)
+        delete session;
+}
+BENCHMARK(BM_SessionFindSlotMap)->Arg(100000);
+
+// One in a hundred sessions leaves per tick and is replaced, the erase loop of UpdateSessions
+static void BM_SessionChurnSlotMap(benchmark::State& state)
+{
+    std::vector<uint32> ids = MakeAccountIds(size_t(state.range(0)));
+    SlotMap<BenchSession*> sessions;
+    for (uint32 id : ids)
+        sessions.Insert(new BenchSession(id));
+
+    std::vector<BenchSession*> left;
+    uint32 tick = 0;
+    for (auto _ : state)
+    {
+        ++tick;
+        for (size_t i = 0; i < sessions.size();)
+        {
+            BenchSession* session = sessions[i];
+            if ((session->AccountId + tick) % 100 == 0)
+            {
+                sessions.EraseAt(i);
+                left.push_back(session);
+            }
+            else
+                ++i;
+        }
+
+        // they come back as new sessions, the way AddSession_ runs before the update loop
+        for (BenchSession* session : left)
+            sessions.Insert(session);
+        left.clear();
+    }
+    state.SetItemsProcessed(int64(state.iterations()) * sessions.size());
+
+    for (BenchSession* session : sessions)
+        delete session;
+}
+BENCHMARK(BM_SessionChurnSlotMap)->Arg(100000);
@@ -0,0 +1,150 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "OpcodeStats.h"
+#include "Metrics.h"
+
+#include <iomanip>
+#include <string>
+#include <utility>
+
+namespace
+{
+    // the owning thread is the only writer of a shard, a plain load and store will do
+    inline void Add(std::atomic<uint64>& counter, uint64 value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+}
+
+OpcodeStats::Shard::Shard()
+{
+    for (uint32 i = 0; i < NUM_MSG_TYPES; ++i)
+    {
+        packetsIn[i].store(0, std::memory_order_relaxed);
+        bytesIn[i].store(0, std::memory_order_relaxed);
+        packetsOut[i].store(0, std::memory_order_relaxed);
+        bytesOut[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+OpcodeStats::Shard& OpcodeStats::GetShard()
+{
+    static thread_local Shard* shard = nullptr;
+    if (!shard)
+    {
+        std::unique_ptr<Shard> created(new Shard());
+        shard = created.get();
+
+        std::lock_guard<std::mutex> guard(_lock);
+        _shards.push_back(std::move(created));
+    }
+
+    return *shard;
+}
+
+void OpcodeStats::RecordReceived(uint32 opcode, uint32 bytes, uint64 handlerTime)
+{
+    if (opcode >= NUM_MSG_TYPES)
+        return;
+
+    Shard& shard = GetShard();
+    Add(shard.packetsIn[opcode], 1);
+    Add(shard.bytesIn[opcode], bytes);
+    shard.handlerTime[opcode].Record(handlerTime);
+}
+
+void OpcodeStats::RecordSent(uint32 opcode, uint32 bytes)
+{
+    if (opcode >= NUM_MSG_TYPES)
+        return;
+
+    Shard& shard = GetShard();
+    Add(shard.packetsOut[opcode], 1);
+    Add(shard.bytesOut[opcode], bytes);
+}
+
+void OpcodeStats::Merge(uint32 opcode, Totals& totals) const
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    for (std::unique_ptr<Shard> const& shard : _shards)
+    {
+        totals.packetsIn += shard->packetsIn[opcode].load(std::memory_order_relaxed);
+        totals.bytesIn += shard->bytesIn[opcode].load(std::memory_order_relaxed);
+        totals.packetsOut += shard->packetsOut[opcode].load(std::memory_order_relaxed);
+        totals.bytesOut += shard->bytesOut[opcode].load(std::memory_order_relaxed);
+        totals.handlerTime.Merge(shard->handlerTime[opcode]);
+    }
+}
+
+void OpcodeStats::Dump(std::ostream& stream) const
+{
+    stream << "Opcode statistics (handler times in microseconds):" << std::endl;
+    stream << std::left << std::setw(32) << "opcode" << std::right
+        << std::setw(12) << "in" << std::setw(14) << "bytes in"
+        << std::setw(12) << "out" << std::setw(14) << "bytes out"
+        << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "max" << std::endl;
+
+    for (uint32 opcode = 0; opcode < NUM_MSG_TYPES; ++opcode)
+    {
+        Totals totals;
+        Merge(opcode, totals);
+        if (!totals.packetsIn && !totals.packetsOut)
+            continue;
+
+        char const* name = LookupOpcodeName(opcode);
+        Histogram const& time = totals.handlerTime;
+        stream << std::left << std::setw(32) << (name ? name : "<unnamed>") << std::right
+            << std::setw(12) << totals.packetsIn << std::setw(14) << totals.bytesIn
+            << std::setw(12) << totals.packetsOut << std::setw(14) << totals.bytesOut
+            << std::setw(10) << time.GetMean() / 1000 << std::setw(10) << time.GetPercentile(50.0) / 1000
+            << std::setw(10) << time.GetPercentile(99.0) / 1000 << std::setw(10) << time.GetMax() / 1000 << std::endl;
+    }
+}
+
+void OpcodeStats::WriteMetrics(MetricsWriter& writer) const
+{
+    // each family's samples have to be written together, so everything is merged first
+    std::unique_ptr<Totals[]> totals(new Totals[NUM_MSG_TYPES]);
+    std::vector<std::pair<uint32, std::string>> seen;
+    for (uint32 opcode = 0; opcode < NUM_MSG_TYPES; ++opcode)
+    {
+        Merge(opcode, totals[opcode]);
+        if (totals[opcode].packetsIn || totals[opcode].packetsOut)
+            seen.push_back(std::make_pair(opcode, std::string("opcode=\"") + LookupOpcodeName(opcode) + "\""));
+    }
+
+    writer.Header("ships_opcode_received_packets_total", "Packets handled per opcode", "counter");
+    for (std::pair<uint32, std::string> const& op : seen)
+        writer.Sample("ships_opcode_received_packets_total", op.second.c_str(), totals[op.first].packetsIn);
+
+    writer.Header("ships_opcode_received_bytes_total", "Payload bytes handled per opcode", "counter");
+    for (std::pair<uint32, std::string> const& op : seen)
+        writer.Sample("ships_opcode_received_bytes_total", op.second.c_str(), totals[op.first].bytesIn);
+
+    writer.Header("ships_opcode_sent_packets_total", "Packets queued for sending per opcode", "counter");
+    for (std::pair<uint32, std::string> const& op : seen)
+        writer.Sample("ships_opcode_sent_packets_total", op.second.c_str(), totals[op.first].packetsOut);
+
+    writer.Header("ships_opcode_sent_bytes_total", "Payload bytes queued for sending per opcode", "counter");
+    for (std::pair<uint32, std::string> const& op : seen)
+        writer.Sample("ships_opcode_sent_bytes_total", op.second.c_str(), totals[op.first].bytesOut);
+
+    writer.Header("ships_opcode_handler_seconds", "Handler time per opcode", "summary");
+    for (std::pair<uint32, std::string> const& op : seen)
+        if (totals[op.first].packetsIn)
+            writer.Summary("ships_opcode_handler_seconds", op.second.c_str(), totals[op.first].handlerTime, 1e-9);
+}
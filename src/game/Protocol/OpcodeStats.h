@@ -0,0 +1,97 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SERVER_OPCODESTATS_H
+#define SERVER_OPCODESTATS_H
+
+#include "Define.h"
+#include "Opcodes.h"
+#include "Histogram.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+class MetricsWriter;
+
+/**
+  * Per-opcode traffic and handler latency.
+  * Every thread records into a shard of its own, so recording takes no lock and shares no
+  * cache line with other threads. Readers merge all shards on demand; the totals are not
+  * one consistent snapshot, each counter is only as current as the moment it was read.
+*/
+class OpcodeStats
+{
+    public:
+        /// Merged view of one opcode
+        struct Totals
+        {
+            Totals() : packetsIn(0), bytesIn(0), packetsOut(0), bytesOut(0) { }
+
+            uint64 packetsIn;
+            uint64 bytesIn;
+            uint64 packetsOut;
+            uint64 bytesOut;
+            Histogram handlerTime;                          // nanoseconds
+        };
+
+        static OpcodeStats* instance()
+        {
+            static OpcodeStats instance;
+            return &instance;
+        }
+
+        /// A packet was handled, handlerTime in nanoseconds
+        void RecordReceived(uint32 opcode, uint32 bytes, uint64 handlerTime);
+        /// A packet was queued for sending
+        void RecordSent(uint32 opcode, uint32 bytes);
+
+        /// Sums up the shards of all threads for opcode (below NUM_MSG_TYPES) into totals
+        void Merge(uint32 opcode, Totals& totals) const;
+
+        /// One line per opcode seen so far
+        void Dump(std::ostream& stream) const;
+        /// Per-opcode counters and handler time summaries of the opcodes seen so far, for the metrics endpoint
+        void WriteMetrics(MetricsWriter& writer) const;
+
+    private:
+        OpcodeStats() { }
+
+        struct Shard
+        {
+            Shard();
+
+            std::atomic<uint64> packetsIn[NUM_MSG_TYPES];
+            std::atomic<uint64> bytesIn[NUM_MSG_TYPES];
+            std::atomic<uint64> packetsOut[NUM_MSG_TYPES];
+            std::atomic<uint64> bytesOut[NUM_MSG_TYPES];
+            Histogram handlerTime[NUM_MSG_TYPES];
+        };
+
+        Shard& GetShard();
+
+        mutable std::mutex _lock;                           // guards _shards, not their contents
+        std::vector<std::unique_ptr<Shard>> _shards;        // outlive their threads, counts are kept
+
+        OpcodeStats(OpcodeStats const& right) = delete;
+        OpcodeStats& operator=(OpcodeStats const& right) = delete;
+};
+
+#define sOpcodeStats OpcodeStats::instance()
+
+#endif
@@ -14,13 +14,37 @@
  */
 
 #include "Opcodes.h"
+#include "Packet.h"
 #include "Session.h"
 
-/// Correspondence between opcodes and their names
-OpcodeHandler opcodeTable[NUM_MSG_TYPES] =
+namespace
 {
-    /*0x001*/ { "CMSG_AUTH",                                  &Session::Handle_NULL                     },
-    /*0x002*/ { "SMSG_AUTH_RESPONSE",                         &Session::Handle_NULL                     },
-    /*0x003*/ { "CMSG_REGISTRATION",                          &Session::Handle_NULL                     },
-    /*0x004*/ { "SMSG_REGISTRATION_RESPONSE",                 &Session::Handle_NULL                     },
-};
+    // opcodeTable is indexed by opcode, so the list must hold every value in order
+    constexpr uint32 ListedOpcodes[] =
+    {
+#define OPCODE_VALUE(name, value, handler, maxSize, status, processing, cost) value,
+        OPCODE_LIST(OPCODE_VALUE)
+#undef OPCODE_VALUE
+    };
+
+    constexpr bool IsListOrdered(uint32 index)
+    {
+        return index == NUM_MSG_TYPES || (ListedOpcodes[index] == index && IsListOrdered(index + 1));
+    }
+}
+
+static_assert(sizeof(ListedOpcodes) / sizeof(ListedOpcodes[0]) == NUM_MSG_TYPES && IsListOrdered(0),
+    "OPCODE_LIST must hold the opcodes in order of their values, without gaps");
+
+void DispatchOpcode(Session& session, Packet& packet)
+{
+    switch (packet.GetOpcode())
+    {
+#define OPCODE_DISPATCH(name, value, handler, maxSize, status, processing, cost) case name: session.handler(packet); break;
+        OPCODE_LIST(OPCODE_DISPATCH)
+#undef OPCODE_DISPATCH
+        default:
+            session.Handle_NULL(packet);
+            break;
+    }
+}
@@ -22,42 +22,111 @@
 
 #include "Define.h"
 
+class Packet;
+class Session;
+
+/// Who may send an opcode
+enum SessionStatus
+{
+    STATUS_NEVER,                                           // server to client only, a client sending it is dropped
+    STATUS_UNAUTHED,                                        // before the socket has a session
+    STATUS_AUTHED                                           // once the socket has a session
+};
+
+/**
+  * Where a handler runs.
+  *
+  * PROCESS_INPLACE packets are handled on the network thread as soon as they are read, see
+  * Socket::ReadDataHandler; they overtake packets still queued for the update. STATUS_UNAUTHED
+  * ones are handled by the socket itself. Session handlers run while the session is updated on
+  * another thread, so they may only read the packet, send packets and use the atomic timeout;
+  * they must not kick (the socket drops the client when the packet is malformed; Socket::CloseSocket
+  * logs and asserts a kick from inside an in-place handler).
+  * PROCESS_THREADSAFE handlers run in the parallel pass, on any update thread and at the same
+  * time as handlers of other sessions. They may only touch their own Session (and its socket);
+  * anything involving other sessions or Server state goes through Server::AddDeferredTask.
+  * PROCESS_THREADUNSAFE handlers run in the serial pass on the world thread, after the parallel
+  * pass has finished, and may touch anything. A session stops its parallel pass at the first
+  * such packet so packets are always handled in the order they were received.
+*/
+enum PacketProcessing
+{
+    PROCESS_INPLACE,
+    PROCESS_THREADUNSAFE,
+    PROCESS_THREADSAFE
+};
+
+/**
+  * All opcodes, in order of their values with no gaps:
+  *     OPCODE(name, value, Session handler, max payload size, SessionStatus, PacketProcessing, cost)
+  * The cost is in units of a session's packet budget, see SessionBudget.
+  * Everything else - the enum, opcodeTable, DispatchOpcode - is generated from this list.
+*/
+#define OPCODE_LIST(OPCODE) \
+    OPCODE(MSG_NULL_ACTION,                 0x000, Handle_NULL,             0,      STATUS_NEVER,       PROCESS_THREADUNSAFE,   0) \
+    OPCODE(CMSG_AUTH,                       0x001, Handle_EarlyProcess,     256,    STATUS_UNAUTHED,    PROCESS_INPLACE,        0) \
+    OPCODE(CMSG_REGISTRATION,               0x002, Handle_EarlyProcess,     512,    STATUS_UNAUTHED,    PROCESS_INPLACE,        0) \
+    OPCODE(SMSG_AUTH_RESPONSE,              0x003, Handle_NULL,             0,      STATUS_NEVER,       PROCESS_THREADUNSAFE,   0) \
+    OPCODE(SMSG_REGISTRATION_RESPONSE,      0x004, Handle_NULL,             0,      STATUS_NEVER,       PROCESS_THREADUNSAFE,   0) \
+    OPCODE(CMSG_PING,                       0x005, HandlePing,              4,      STATUS_AUTHED,      PROCESS_INPLACE,        1) \
+    OPCODE(SMSG_PONG,                       0x006, Handle_NULL,             0,      STATUS_NEVER,       PROCESS_THREADUNSAFE,   0)
+
 enum Opcodes : uint32
 {
-    CMSG_AUTH                                                      = 0x001,
-    CMSG_REGISTRATION                                              = 0x002,
-    SMSG_AUTH_RESPONSE                                             = 0x003,
-    CMSG_REGISTRATION_RESPONSE                                     = 0x004,
-    NUM_MSG_TYPES                                                  = 0x005
+#define OPCODE_ENUM(name, value, handler, maxSize, status, processing, cost) name = value,
+    OPCODE_LIST(OPCODE_ENUM)
+#undef OPCODE_ENUM
+    NUM_MSG_TYPES
+};
+
+/**
+  * Payloads of the handshake opcodes:
+  *     CMSG_AUTH, CMSG_REGISTRATION:   string account, string password
+  *     SMSG_REGISTRATION_RESPONSE:     uint8 RegistrationResult, at most once per connection
+  * SMSG_AUTH_RESPONSE has no format yet, the socket closes the connection after CMSG_AUTH.
+*/
+enum RegistrationResult : uint8
+{
+    REGISTRATION_REFUSED                                           = 0,     // no account was created, CMSG_AUTH may still follow
+    REGISTRATION_CREATED                                           = 1
 };
 
 enum OpcodeMisc : uint32
 {
-    NUM_OPCODE_HANDLERS                                            = (NUM_MSG_TYPES + 1),
     NULL_OPCODE                                                    = 0xBADD
 };
 
-class Packet;
-class Session;
-
-#if defined(__GNUC__)
-#pragma pack(1)
-#else
-#pragma pack(push, 1)
-#endif
-
 struct OpcodeHandler
 {
     char const* name;
-    void (Session::*handler)(Packet& recvPacket);
+    uint16 maxSize;                                         // payload, without the header
+    SessionStatus status;
+    PacketProcessing processing;
+    uint16 cost;
 };
 
-extern OpcodeHandler opcodeTable[NUM_MSG_TYPES];
+/// Indexed by opcode, opcodes are checked against NUM_MSG_TYPES when their packet is read
+constexpr OpcodeHandler opcodeTable[NUM_MSG_TYPES] =
+{
+#define OPCODE_ENTRY(name, value, handler, maxSize, status, processing, cost) { #name, maxSize, status, processing, cost },
+    OPCODE_LIST(OPCODE_ENTRY)
+#undef OPCODE_ENTRY
+};
+
+/// False while no opcode is PROCESS_THREADSAFE, the parallel session pass then has nothing to do
+constexpr bool hasThreadSafeOpcodes = false
+#define OPCODE_THREADSAFE(name, value, handler, maxSize, status, processing, cost) || processing == PROCESS_THREADSAFE
+    OPCODE_LIST(OPCODE_THREADSAFE)
+#undef OPCODE_THREADSAFE
+    ;
+
+/// Calls the handler of the packet's opcode, a switch over OPCODE_LIST
+void DispatchOpcode(Session& session, Packet& packet);
 
 /// Lookup opcode name for human understandable logging
 inline const char* LookupOpcodeName(uint16 id)
 {
-    if (id > NUM_OPCODE_HANDLERS)
+    if (id >= NUM_MSG_TYPES)
         return "Received unknown opcode, it's more than max!";
     return opcodeTable[id].name;
 }
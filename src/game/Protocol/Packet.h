@@ -17,6 +17,7 @@
 #define SERVER_PACKET_H
 
 #include "ByteBuffer.h"
+#include "Headers.h"
 
 class Packet : public ByteBuffer
 {
@@ -26,7 +27,13 @@ class Packet : public ByteBuffer
         {
         }
 
-        Packet(uint32 opcode, size_t res = 200) : ByteBuffer(res), m_opcode(opcode) { }
+        // small packets fit the inline storage, pass res only when the final size is known to be large
+        // room for the server header is kept in front of the payload, see MoveWithHeader()
+        Packet(uint32 opcode, size_t res = 0) : ByteBuffer(), m_opcode(opcode)
+        {
+            _storage.reserve_headroom(sizeof(ServerHeader));
+            _storage.reserve(res);
+        }
 
         Packet(Packet&& packet) : ByteBuffer(std::move(packet)), m_opcode(packet.m_opcode)
         {
@@ -60,13 +67,33 @@ class Packet : public ByteBuffer
 
         Packet(uint32 opcode, MessageBuffer&& buffer) : ByteBuffer(std::move(buffer)), m_opcode(opcode) { }
 
-        void Initialize(uint32 opcode, size_t newres = 200)
+        void Initialize(uint32 opcode, size_t newres = 0)
         {
             clear();
+            _storage.reserve_headroom(sizeof(ServerHeader));
             _storage.reserve(newres);
             m_opcode = opcode;
         }
 
+        /// False for packets built from received data, those have no room for the server header
+        bool HasHeaderRoom() const { return _storage.headroom() >= sizeof(ServerHeader); }
+
+        /**
+          * @name   MoveWithHeader
+          * @brief  Writes the server header into the reserved room and gives up the storage, header and payload
+          *         as one block ready for the socket. Requires HasHeaderRoom(), the packet is left empty.
+        */
+        ByteBufferStorage&& MoveWithHeader()
+        {
+            FlushBits();
+
+            ServerHeader header;
+            header.Size = uint16(size());
+            header.Command = m_opcode;
+            std::memcpy(_storage.claim_headroom(sizeof(header)), &header, sizeof(header));
+            return Move();
+        }
+
         uint32 GetOpcode() const { return m_opcode; }
         void SetOpcode(uint32 opcode) { m_opcode = opcode; }
     protected:
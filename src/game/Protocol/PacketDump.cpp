@@ -0,0 +1,197 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PacketDump.h"
+#include "Packet.h"
+#include "Opcodes.h"
+#include "Timer.h"
+#include "Log.h"
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+uint32 const PacketDump::REPORT_INTERVAL;
+
+PacketDump::PacketDump() : _thread(nullptr), _stopped(false), _first(0), _count(0),
+    _rateLimited(0), _ringFull(0), _busy(0), _reportedSuppressed(0)
+{
+    std::memset(_rates, 0, sizeof(_rates));
+}
+
+PacketDump::~PacketDump()
+{
+    Stop();
+}
+
+void PacketDump::Start()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    if (_thread)
+        return;
+
+    _stopped = false;
+    _thread = new std::thread(&PacketDump::Run, this);
+}
+
+void PacketDump::Stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (!_thread)
+            return;
+
+        _stopped = true;
+    }
+
+    _wakeup.notify_one();
+    _thread->join();
+    delete _thread;
+    _thread = nullptr;
+}
+
+bool PacketDump::Capture(Packet const& packet, std::string const& address)
+{
+    std::unique_lock<std::mutex> guard(_lock, std::try_to_lock);
+    if (!guard.owns_lock())
+    {
+        _busy.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    uint32 now = getMSTime();
+    if (!AllowDump(address, now))
+    {
+        _rateLimited.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // the formatter is behind, keep the older dumps
+    if (_count == RING_SIZE)
+    {
+        _ringFull.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    Entry& entry = _ring[(_first + _count) % RING_SIZE];
+    entry.time = now;
+    entry.opcode = packet.GetOpcode();
+    entry.size = uint32(packet.size());
+    entry.rpos = uint32(packet.rpos());
+    entry.length = uint32(packet.size() < MAX_CAPTURE_SIZE ? packet.size() : MAX_CAPTURE_SIZE);
+    if (entry.length)
+        std::memcpy(entry.data, packet.contents(), entry.length);
+
+    size_t addressLength = address.size() < ADDRESS_SIZE ? address.size() : ADDRESS_SIZE - 1;
+    std::memcpy(entry.address, address.data(), addressLength);
+    entry.address[addressLength] = '\0';
+
+    ++_count;
+    guard.unlock();
+
+    _wakeup.notify_one();
+    return true;
+}
+
+bool PacketDump::AllowDump(std::string const& address, uint32 now)
+{
+    // a fixed table, two addresses sharing a slot just restart each other's window
+    size_t hash = std::hash<std::string>()(address);
+    RateEntry& rate = _rates[hash % RATE_TABLE_SIZE];
+    if (rate.hash != hash || getMSTimeDiff(rate.windowStart, now) >= RATE_WINDOW)
+    {
+        rate.hash = hash;
+        rate.windowStart = now;
+        rate.count = 0;
+    }
+
+    if (rate.count >= DUMPS_PER_ADDRESS)
+        return false;
+
+    ++rate.count;
+    return true;
+}
+
+void PacketDump::Run()
+{
+    Entry entry;
+
+    std::unique_lock<std::mutex> guard(_lock);
+    while (true)
+    {
+        // wakes up now and then even without dumps, suppressed ones are reported too
+        if (!_count && !_stopped)
+            _wakeup.wait_for(guard, std::chrono::seconds(REPORT_INTERVAL));
+
+        bool haveEntry = _count != 0;
+        if (haveEntry)
+        {
+            entry = _ring[_first];
+            _first = (_first + 1) % RING_SIZE;
+            --_count;
+        }
+        else if (_stopped)
+            break;                                          // everything captured before Stop() is written out
+
+        guard.unlock();
+        if (haveEntry)
+            Format(entry);
+        ReportSuppressed();
+        guard.lock();
+    }
+}
+
+void PacketDump::Format(Entry const& entry) const
+{
+    // one record per line, all at the same level so a level threshold never keeps half a dump
+    sLog->WaitForRoom((entry.length + 15) / 16 + 2);         // header, rows and trailer
+    LOG_WARN("packetdump", "PacketDump: malformed packet {} ({}) from {}, size {}, parsed up to {}, time {}",
+        LookupOpcodeName(uint16(entry.opcode)), entry.opcode, entry.address, entry.size, entry.rpos, entry.time);
+
+    // offset, 16 bytes in hex, the same bytes as text
+    char line[256];
+    for (uint32 offset = 0; offset < entry.length; offset += 16)
+    {
+        int pos = snprintf(line, sizeof(line), "%04X ", offset);
+        for (uint32 i = offset; i < offset + 16; ++i)
+        {
+            if (i < entry.length)
+                pos += snprintf(line + pos, sizeof(line) - pos, " %02X", entry.data[i]);
+            else
+                pos += snprintf(line + pos, sizeof(line) - pos, "   ");
+        }
+
+        pos += snprintf(line + pos, sizeof(line) - pos, "  ");
+        for (uint32 i = offset; i < offset + 16 && i < entry.length; ++i)
+            line[pos++] = (entry.data[i] >= 0x20 && entry.data[i] < 0x7F) ? char(entry.data[i]) : '.';
+
+        line[pos] = '\0';
+        LOG_WARN("packetdump", "{}", line);
+    }
+
+    if (entry.size > entry.length)
+        LOG_WARN("packetdump", "({} more bytes not captured)", entry.size - entry.length);
+}
+
+void PacketDump::ReportSuppressed()
+{
+    uint64 suppressed = GetSuppressedCount();
+    if (suppressed == _reportedSuppressed)
+        return;
+
+    LOG_WARN("packetdump", "PacketDump: {} malformed packets not dumped (rate limited {}, ring full {}, busy {} in total)", suppressed - _reportedSuppressed,
+        _rateLimited.load(std::memory_order_relaxed), _ringFull.load(std::memory_order_relaxed), _busy.load(std::memory_order_relaxed));
+    _reportedSuppressed = suppressed;
+}
@@ -0,0 +1,113 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SERVER_PACKETDUMP_H
+#define SERVER_PACKETDUMP_H
+
+#include "Define.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class Packet;
+
+/**
+  * Diagnostics for malformed packets.
+  * Capture() copies the raw bytes into a fixed ring and returns at once, a background
+  * thread writes the hex dumps to the log, category "packetdump", waiting for room in its
+  * log ring so a dump is never cut off. Capturing never waits:
+  * when the ring is busy, full or the client address is over its rate, the packet is only
+  * counted as suppressed.
+*/
+class PacketDump
+{
+    public:
+        static size_t const RING_SIZE = 64;                 // dumps waiting for the formatter
+        static size_t const MAX_CAPTURE_SIZE = 512;         // bytes kept of each packet
+        static size_t const ADDRESS_SIZE = 48;              // fits a textual IPv6 address
+        static size_t const RATE_TABLE_SIZE = 256;
+        static uint32 const DUMPS_PER_ADDRESS = 4;          // per RATE_WINDOW
+        static uint32 const RATE_WINDOW = 60 * 1000;
+        static uint32 const REPORT_INTERVAL = 10;           // seconds between reports of suppressed dumps
+
+        static PacketDump* instance()
+        {
+            static PacketDump instance;
+            return &instance;
+        }
+
+        ~PacketDump();
+
+        /// Starts the formatting thread, dumps captured before are formatted then
+        void Start();
+        /// Formats what is left in the ring and stops the formatting thread
+        void Stop();
+
+        /// Keeps packet for dumping, false if it was suppressed
+        bool Capture(Packet const& packet, std::string const& address);
+
+        uint64 GetSuppressedCount() const { return _rateLimited.load(std::memory_order_relaxed) + _ringFull.load(std::memory_order_relaxed) + _busy.load(std::memory_order_relaxed); }
+
+    private:
+        PacketDump();
+
+        struct Entry
+        {
+            uint32 time;
+            uint32 opcode;
+            uint32 size;                                    // whole packet, may be more than length
+            uint32 rpos;                                    // where parsing stopped
+            uint32 length;
+            char address[ADDRESS_SIZE];
+            uint8 data[MAX_CAPTURE_SIZE];
+        };
+
+        struct RateEntry
+        {
+            size_t hash;
+            uint32 windowStart;
+            uint32 count;
+        };
+
+        bool AllowDump(std::string const& address, uint32 now);
+        void Run();
+        void Format(Entry const& entry) const;
+        void ReportSuppressed();
+
+        std::mutex _lock;
+        std::condition_variable _wakeup;
+        std::thread* _thread;
+        bool _stopped;
+
+        Entry _ring[RING_SIZE];
+        size_t _first;
+        size_t _count;
+        RateEntry _rates[RATE_TABLE_SIZE];
+
+        std::atomic<uint64> _rateLimited;
+        std::atomic<uint64> _ringFull;
+        std::atomic<uint64> _busy;
+        uint64 _reportedSuppressed;                         // formatter thread only
+
+        PacketDump(PacketDump const& right) = delete;
+        PacketDump& operator=(PacketDump const& right) = delete;
+};
+
+#define sPacketDump PacketDump::instance()
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PacketPool.h"
+#include "Packet.h"
+
+std::atomic<uint64> PacketPool::_allocationCount(0);
+std::atomic<uint64> PacketPool::_recycleCount(0);
+
+PacketPool::PacketPool(size_t maxCached) : _maxCached(maxCached)
+{
+}
+
+PacketPool::~PacketPool()
+{
+    for (Packet* packet : _cache)
+        delete packet;
+
+    for (Packet* packet : _released)
+        delete packet;
+
+    for (Packet* packet : _returned)
+        delete packet;
+}
+
+Packet* PacketPool::Acquire(Packet&& packet)
+{
+    if (_cache.empty())
+    {
+        std::lock_guard<std::mutex> lock(_returnedLock);
+        _cache.swap(_returned);
+    }
+
+    if (_cache.empty())
+    {
+        _allocationCount.fetch_add(1, std::memory_order_relaxed);
+        return new Packet(std::move(packet));
+    }
+
+    Packet* recycled = _cache.back();
+    _cache.pop_back();
+    *recycled = std::move(packet);
+    return recycled;
+}
+
+void PacketPool::Flush()
+{
+    if (_released.empty())
+        return;
+
+    size_t recycled = 0;
+    {
+        std::lock_guard<std::mutex> lock(_returnedLock);
+        while (!_released.empty() && _returned.size() < _maxCached)
+        {
+            _returned.push_back(_released.back());
+            _released.pop_back();
+            ++recycled;
+        }
+    }
+
+    // more than the receiving side will ever need at once
+    for (Packet* packet : _released)
+        delete packet;
+    _released.clear();
+
+    _recycleCount.fetch_add(recycled, std::memory_order_relaxed);
+}
@@ -0,0 +1,72 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SERVER_PACKETPOOL_H
+#define SERVER_PACKETPOOL_H
+
+#include "Define.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+class Packet;
+
+/**
+  * Recycles received Packet objects of one session.
+  * The receiving side (network thread) takes packets from a private cache and only
+  * locks to swap in the packets given back since it last ran dry. The updating side
+  * collects handled packets with Release() and hands them back in bulk with Flush(),
+  * once per session update.
+*/
+class PacketPool
+{
+    public:
+        static size_t const DEFAULT_CACHE_SIZE = 64;
+
+        explicit PacketPool(size_t maxCached = DEFAULT_CACHE_SIZE);
+        ~PacketPool();
+
+        /// Receiving side: moves packet into a recycled (or, if none is left, new) Packet
+        Packet* Acquire(Packet&& packet);
+
+        /// Updating side: marks a handled packet for reuse
+        void Release(Packet* packet) { _released.push_back(packet); }
+
+        /// Updating side: returns everything released since the last call to the receiving side
+        void Flush();
+
+        /// Packets allocated because no recycled one was available, over all pools
+        static uint64 GetAllocationCount() { return _allocationCount.load(std::memory_order_relaxed); }
+        /// Packets handed back for reuse, each one saves an allocation on a later receive
+        static uint64 GetRecycleCount() { return _recycleCount.load(std::memory_order_relaxed); }
+
+    private:
+        size_t _maxCached;
+
+        std::vector<Packet*> _cache;                        // receiving side only
+        std::vector<Packet*> _released;                     // updating side only
+
+        std::mutex _returnedLock;
+        std::vector<Packet*> _returned;
+
+        static std::atomic<uint64> _allocationCount;
+        static std::atomic<uint64> _recycleCount;
+
+        PacketPool(PacketPool const& right) = delete;
+        PacketPool& operator=(PacketPool const& right) = delete;
+};
+
+#endif
@@ -16,65 +16,206 @@
 #include "Server.h"
 #include "Socket.h"
 #include "Session.h"
+#include "Opcodes.h"
+#include "OpcodeStats.h"
+#include "PacketPool.h"
+#include "Metrics.h"
+#include "DatabaseEnv.h"
+
+#include <algorithm>
+#include <thread>
 
 std::atomic<bool> Server::m_stopEvent(false);
 std::atomic<uint32> Server::m_serverLoopCounter(0);
 
 void Server::Update(uint32 diff)
 {
+    m_tickProfiler.BeginTick();
+
+    ///- Results of the statements that finished since the last tick
+    Database.ProcessCallbacks();
+
+    m_tickProfiler.EndPhase(TICK_PHASE_DATABASE);
+
     UpdateSessions(diff);
+
+    m_tickProfiler.EndTick();
 }
 
 void Server::UpdateSessions(uint32 diff)
 {
-    ///- Add new sessions
-    Session* sess = NULL;
-    while (m_sessionQueue.next(sess))
-        AddSession_(sess);
+    ///- Add new sessions, all taken under one lock
+    if (m_sessionQueue.drain(m_newSessions))
+        for (Session* sess : m_newSessions)
+            AddSession_(sess);
+
+    m_tickProfiler.EndPhase(TICK_PHASE_NEW_SESSIONS);
 
-    ///- Then send an update signal to remaining ones
-    if (!m_sessions.empty())
+    ///- Thread-safe packets of all sessions, update groups spread over the pool
+    if (m_updatePool && m_sessions.size() > SESSION_UPDATE_GROUP_SIZE)
     {
-        for (SessionMap::iterator itr = m_sessions.begin(), next; itr != m_sessions.end(); itr = next)
+        size_t groups = (m_sessions.size() + SESSION_UPDATE_GROUP_SIZE - 1) / SESSION_UPDATE_GROUP_SIZE;
+        m_updatePool->Run(groups, [this, diff](size_t group)
         {
-            next = itr;
-            ++next;
+            size_t end = std::min((group + 1) * SESSION_UPDATE_GROUP_SIZE, m_sessions.size());
+            for (size_t i = group * SESSION_UPDATE_GROUP_SIZE; i < end; ++i)
+                m_sessions[i]->Update(diff, m_sessionBudget, UPDATE_PASS_PARALLEL);
+        });
+    }
+
+    m_tickProfiler.EndPhase(TICK_PHASE_PARALLEL);
 
-            ///- and remove not active sessions from the list
-            Session* pSession = itr->second;
-            if (!pSession->Update(diff))
-            {
-                m_sessions.erase(itr);
-                delete pSession;
+    ///- Past the barrier, cross-session work of the parallel pass
+    RunDeferredTasks();
 
-            }
+    m_tickProfiler.EndPhase(TICK_PHASE_DEFERRED);
+
+    static MetricCounter& removed = sMetrics->GetCounter("ships_sessions_removed_total", "Sessions closed or kicked");
+
+    // packets left over by the budget were signalled once already, the next tick must not wait for another
+    bool overBudget = false;
+
+    ///- Then send an update signal to remaining ones, this handles all packets left
+    for (size_t i = 0; i < m_sessions.size();)
+    {
+        ///- and remove not active sessions from the list, the last one moves into the hole and is updated next
+        Session* pSession = m_sessions[i];
+        if (!pSession->Update(diff, m_sessionBudget))
+        {
+            SessionAccountIndex::iterator itr = m_sessionsByAccount.find(pSession->GetAccountId());
+            if (itr != m_sessionsByAccount.end() && itr->second == m_sessions.GetHandle(i))
+                m_sessionsByAccount.erase(itr);
+
+            m_sessions.EraseAt(i);
+            delete pSession;
+            removed.Add();
+        }
+        else
+        {
+            overBudget |= pSession->IsOverBudget();
+            ++i;
         }
     }
+
+    if (overBudget)
+        SignalInput();
+
+    m_tickProfiler.EndPhase(TICK_PHASE_SERIAL);
+
+    static MetricGauge& active = sMetrics->GetGauge("ships_sessions", "Sessions in the world");
+    active.Set(int64(m_sessions.size()));
+}
+
+void Server::SetUpdateThreads(uint32 threads)
+{
+    // without a thread-safe opcode the pool would only wake up and meet at the barrier every tick
+    m_updatePool.reset(threads && hasThreadSafeOpcodes ? new WorkerPool(threads) : nullptr);
+}
+
+void Server::RegisterMetrics()
+{
+    // run on the io thread serving the scrape, reading the shards and histograms the way Dump does
+    sMetrics->AddCollector([this](MetricsWriter& writer) { m_tickProfiler.WriteMetrics(writer); });
+    sMetrics->AddCollector([](MetricsWriter& writer) { sOpcodeStats->WriteMetrics(writer); });
+    sMetrics->AddCollector([](MetricsWriter& writer)
+    {
+        writer.Header("ships_packet_pool_allocations_total", "Received packets allocated because no recycled one was left", "counter");
+        writer.Sample("ships_packet_pool_allocations_total", nullptr, PacketPool::GetAllocationCount());
+        writer.Header("ships_packet_pool_recycles_total", "Received packets handed back for reuse, each saves a later allocation", "counter");
+        writer.Sample("ships_packet_pool_recycles_total", nullptr, PacketPool::GetRecycleCount());
+    });
+}
+
+void Server::AddDeferredTask(std::function<void()>&& task)
+{
+    std::lock_guard<std::mutex> guard(m_deferredLock);
+    m_deferredTasks.push_back(std::move(task));
+}
+
+void Server::SignalInput()
+{
+    // only the first signal after a wakeup needs the lock, the rest find the flag set already
+    if (m_pendingInput.load(std::memory_order_relaxed) || m_pendingInput.exchange(true))
+        return;
+
+    std::lock_guard<std::mutex> guard(m_inputLock);
+    m_inputSignal.notify_one();
+}
+
+bool Server::WaitForInput(uint32 minWait, uint32 maxWait)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // fixed-rate parts of the simulation still get a minimum tick
+    if (minWait)
+        std::this_thread::sleep_for(std::chrono::milliseconds(minWait));
+
+    bool signalled;
+    {
+        std::unique_lock<std::mutex> guard(m_inputLock);
+        signalled = m_inputSignal.wait_until(guard, start + std::chrono::milliseconds(maxWait), [this]() { return m_pendingInput.load(); });
+    }
+
+    m_pendingInput.store(false);
+    return signalled;
+}
+
+void Server::RunDeferredTasks()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_deferredLock);
+        if (m_deferredTasks.empty())
+            return;
+
+        m_runningTasks.swap(m_deferredTasks);
+    }
+
+    for (std::function<void()>& task : m_runningTasks)
+        task();
+
+    m_runningTasks.clear();
 }
 
 Session* Server::FindSession(uint32 id) const
 {
-    SessionMap::const_iterator itr = m_sessions.find(id);
-    if (itr != m_sessions.end())
-        return itr->second;                                 // also can return NULL for kicked session
+    return FindSession(GetSessionHandle(id));
+}
+
+Session* Server::FindSession(SessionHandle handle) const
+{
+    if (Session* const* session = m_sessions.Find(handle))
+        return *session;
 
     return nullptr;
 }
 
+SessionHandle Server::GetSessionHandle(uint32 id) const
+{
+    SessionAccountIndex::const_iterator itr = m_sessionsByAccount.find(id);
+    if (itr != m_sessionsByAccount.end())
+        return itr->second;
+
+    return SessionMap::INVALID_HANDLE;
+}
+
 void Server::RemoveSession(uint32 id)
 {
-    SessionMap::const_iterator itr = m_sessions.find(id);
-    if (itr != m_sessions.end() && itr->second)
-        itr->second->KickPlayer();
+    if (Session* session = FindSession(id))
+        session->KickPlayer();
 }
 
 void Server::AddSession(Session* s)
 {
     m_sessionQueue.add(s);
+    SignalInput();
 }
 
 void Server::AddSession_(Session* s)
 {
+    // the old session stays until its next update sees the kick, only the index moves on
     RemoveSession(s->GetAccountId());
-    m_sessions[s->GetAccountId()] = s;
+    m_sessionsByAccount[s->GetAccountId()] = m_sessions.Insert(s);
+
+    static MetricCounter& added = sMetrics->GetCounter("ships_sessions_added_total", "Sessions that entered the world");
+    added.Add();
 }
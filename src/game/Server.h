@@ -19,12 +19,35 @@
 #include "Timer.h"
 #include "Define.h"
 #include "LockedQueue.h"
+#include "SlotMap.h"
+#include "WorkerPool.h"
+#include "TickProfiler.h"
 
 class Session;
 
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
-typedef std::unordered_map<uint32, Session*> SessionMap;
+// sessions handed to an update thread at a time in the parallel pass
+#define SESSION_UPDATE_GROUP_SIZE 16
+
+/// Work one session may do per tick, packets left over wait for the next tick; 0 is no limit
+struct SessionBudget
+{
+    SessionBudget() : cost(0), time(0) { }
+    SessionBudget(uint32 cost_, uint32 time_) : cost(cost_), time(time_) { }
+
+    uint32 cost;                                            // sum of OpcodeHandler::cost of the handled packets
+    uint32 time;                                            // microseconds spent in handlers
+};
+
+typedef SlotMap<Session*> SessionMap;
+typedef SessionMap::Handle SessionHandle;
+typedef std::unordered_map<uint32, SessionHandle> SessionAccountIndex;
 
 /// The World
 class Server
@@ -40,6 +63,9 @@ class Server
 
         // Sessions
         Session* FindSession(uint32 id) const;
+        Session* FindSession(SessionHandle handle) const;
+        /// Handle of the session of account id, stays valid (or finds nothing) across ticks
+        SessionHandle GetSessionHandle(uint32 id) const;
         void AddSession(Session* s);
         void RemoveSession(uint32 id);
         void AddSession_(Session* s);
@@ -48,11 +74,50 @@ class Server
         void Update(uint32 diff);
         void UpdateSessions(uint32 diff);
 
+        /// Threads besides the world thread for the parallel session pass, 0 updates serially only (as does a protocol without PROCESS_THREADSAFE opcodes)
+        void SetUpdateThreads(uint32 threads);
+
+        /// Per session and tick, at least one packet is always handled so a session never stalls
+        void SetSessionBudget(SessionBudget const& budget) { m_sessionBudget = budget; }
+        SessionBudget const& GetSessionBudget() const { return m_sessionBudget; }
+
+        /// Cross-session work from thread-safe handlers, run on the world thread after the parallel pass
+        void AddDeferredTask(std::function<void()>&& task);
+
+        /// Network threads: there is new work for the world thread, wakes WaitForInput
+        void SignalInput();
+        /// World thread: sleeps minWait ms, then waits until maxWait ms have passed in all or input is signalled. False when none was.
+        bool WaitForInput(uint32 minWait, uint32 maxWait);
+
+        TickProfiler& GetTickProfiler() { return m_tickProfiler; }
+
+        /// Adds the tick and opcode statistics to sMetrics, once at startup
+        void RegisterMetrics();
+
         static bool IsStopped() { return m_stopEvent; }
     private:
+        Server() : m_pendingInput(false) { }
+
+        void RunDeferredTasks();
+
         static std::atomic<bool> m_stopEvent;
         LockedQueue<Session*> m_sessionQueue;
+        LockedQueue<Session*>::storage_type m_newSessions;  // swapped with m_sessionQueue each tick
         SessionMap m_sessions;
+        SessionAccountIndex m_sessionsByAccount;
+
+        SessionBudget m_sessionBudget;
+        std::unique_ptr<WorkerPool> m_updatePool;
+
+        TickProfiler m_tickProfiler;
+
+        std::mutex m_inputLock;
+        std::condition_variable m_inputSignal;
+        std::atomic<bool> m_pendingInput;                   // set by SignalInput, cleared when the world thread wakes
+
+        std::mutex m_deferredLock;
+        std::vector<std::function<void()>> m_deferredTasks;
+        std::vector<std::function<void()>> m_runningTasks;
 };
 
 #define sServer Server::instance()
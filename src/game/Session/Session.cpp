@@ -17,9 +17,15 @@
 #include "Socket.h"
 #include "Opcodes.h"
 #include "Session.h"
+#include "PacketDump.h"
+#include "OpcodeStats.h"
+#include "Timer.h"
+#include "Log.h"
+#include "Metrics.h"
 
 // Session constructor
-Session::Session(uint32 id, std::string&& name, std::shared_ptr<Socket> sock) : m_accountId(id), m_accountName(std::move(name)), m_forceExit(false), m_timeOutTime(0)
+Session::Session(uint32 id, std::string&& name, std::shared_ptr<Socket> sock) : m_accountId(id), m_accountName(std::move(name)), m_forceExit(false), m_timeOutTime(SOCKET_TIMEOUT),
+    _recvQueue(SESSION_RECV_QUEUE_SIZE), _spentCost(0), _spentTime(0), _overBudget(false)
 {
     if (sock)
         m_Address = sock.get()->GetRemoteIpAddress().to_string();
@@ -35,6 +41,13 @@ Session::~Session()
         m_Socket->CloseSocket();
         m_Socket.reset();
     }
+
+    /// empty incoming packet queue
+    _recvQueue.drain([](Packet* packet) -> bool
+    {
+        delete packet;
+        return true;
+    });
 }
 
 void Session::KickPlayer()
@@ -46,32 +59,61 @@ void Session::KickPlayer()
     }
 }
 
-bool Session::Update(uint32 diff)
+bool PacketFilter::Process(Packet* packet) const
 {
-    /// Update Timeout timer.
-    UpdateTimeOutTime(diff);
+    if (_pass == UPDATE_PASS_SERIAL)
+        return true;
 
-    if (IsConnectionIdle()) // Connection socket timeout
-        return false;
+    return opcodeTable[packet->GetOpcode()].processing == PROCESS_THREADSAFE;
+}
+
+bool Session::HasBudgetLeft(SessionBudget const& budget) const
+{
+    return (!budget.cost || _spentCost < budget.cost) && (!budget.time || _spentTime < uint64(budget.time) * 1000);
+}
 
-    Packet* packet = nullptr;
-    while (m_Socket && m_Socket->IsOpen() && !_recvQueue.empty() && _recvQueue.next(packet))
+bool Session::Update(uint32 diff, SessionBudget const& budget, SessionUpdatePass pass)
+{
+    if (pass == UPDATE_PASS_SERIAL)
     {
-        OpcodeHandler const& opHandle = opcodeTable[packet->GetOpcode()];
-        try
-        {
-            (this->*opHandle.handler)(*packet);
-        }
-        catch (ByteBufferException const&)
+        /// Update Timeout timer.
+        UpdateTimeOutTime(diff);
+
+        if (IsConnectionIdle()) // Connection socket timeout
+            return false;
+    }
+
+    if (pass == UPDATE_PASS_SERIAL)
+        _overBudget = false;
+
+    /// Everything queued when the pass starts in one batch, as far as the budget goes; the rest stays queued
+    PacketFilter filter(pass);
+    _recvQueue.drain([this, &filter, &budget](Packet* packet) -> bool
+    {
+        if (!m_Socket || !m_Socket->IsOpen() || !filter.Process(packet))
+            return false;
+
+        if (!HasBudgetLeft(budget))
         {
-           // TC_LOG_FATAL("network", "WorldSession::Update ByteBufferException occured while parsing a packet (opcode: %s) from client %s, accountid=%i. Skipped packet.",
-           //     GetOpcodeNameForLogging(static_cast<OpcodeClient>(packet->GetOpcode())).c_str(), GetRemoteAddress().c_str(), GetAccountId());
-            packet->hexlike();
-            KickPlayer();
+            _overBudget = true;
+            return false;
         }
 
-        delete packet;
-    }
+        _spentCost += opcodeTable[packet->GetOpcode()].cost;
+        _spentTime += HandlePacket(packet);
+        return true;
+    });
+
+    /// Hand all handled packets back to the receiving side at once
+    _packetPool.Flush();
+
+    /// Removal is left to the serial pass
+    if (pass == UPDATE_PASS_PARALLEL)
+        return true;
+
+    /// The serial pass ends the tick of this session
+    _spentCost = 0;
+    _spentTime = 0;
 
     /// Cleanup sockets
     if (!m_Socket || m_forceExit || (m_Socket && !m_Socket->IsOpen()))
@@ -80,9 +122,71 @@ bool Session::Update(uint32 diff)
     return true;
 }
 
-void Session::QueuePacket(Packet* packet)
+bool Session::CallHandler(Packet& packet, uint64& elapsed)
+{
+    uint64 start = getNSTime();
+    bool valid = true;
+
+    // malformed packets flag the packet instead of throwing, handlers check HasReadError() once
+    packet.SetCheckedReads(true);
+    try
+    {
+        DispatchOpcode(*this, packet);
+        valid = !packet.HasReadError();
+    }
+    catch (ByteBufferException const&)
+    {
+       // TC_LOG_FATAL("network", "WorldSession::Update ByteBufferException occured while parsing a packet (opcode: %s) from client %s, accountid=%i. Skipped packet.",
+       //     GetOpcodeNameForLogging(static_cast<OpcodeClient>(packet->GetOpcode())).c_str(), GetRemoteAddress().c_str(), GetAccountId());
+        valid = false;
+    }
+
+    // never formatted here, a hostile client must not be able to stall the update
+    if (!valid)
+    {
+        static MetricCounter& malformed = sMetrics->GetCounter("ships_packets_malformed_total", "Packets whose handler failed to read them, the session is kicked");
+        malformed.Add();
+        sPacketDump->Capture(packet, m_Address);
+    }
+
+    elapsed = getNSTime() - start;
+    sOpcodeStats->RecordReceived(packet.GetOpcode(), uint32(packet.size()), elapsed);
+    return valid;
+}
+
+uint64 Session::HandlePacket(Packet* packet)
 {
-    _recvQueue.add(packet);
+    uint64 elapsed;
+    if (!CallHandler(*packet, elapsed))
+        KickPlayer();
+
+    _packetPool.Release(packet);
+    return elapsed;
+}
+
+bool Session::HandleInplacePacket(Packet& packet)
+{
+    ResetTimeOutTime();
+
+    uint64 elapsed;
+    return CallHandler(packet, elapsed);
+}
+
+bool Session::QueuePacket(Packet&& packet)
+{
+    // only this thread adds, so a queue that is not full now still has room below
+    if (_recvQueue.full())
+    {
+        static MetricCounter& overflows = sMetrics->GetCounter("ships_session_queue_overflows_total", "Sessions kicked for overflowing their receive queue");
+        overflows.Add();
+        LOG_WARN("session", "Session::QueuePacket: client {} (account {}) overflowed its receive queue, kicking", m_Address, m_accountId);
+        return false;
+    }
+
+    _recvQueue.add(_packetPool.Acquire(std::move(packet)));
+    ResetTimeOutTime();
+    sServer->SignalInput();
+    return true;
 }
 
 void Session::SendPacket(Packet const* packet)
@@ -90,7 +194,30 @@ void Session::SendPacket(Packet const* packet)
     m_Socket->SendPacket(*packet);
 }
 
+void Session::SendPacket(Packet&& packet)
+{
+    m_Socket->SendPacket(std::move(packet));
+}
+
 void Session::Handle_NULL(Packet& recvPacket)
 {
-    std::cout << "Session: received unimplemented opcode " << LookupOpcodeName(recvPacket.GetOpcode()) << "(" << recvPacket.GetOpcode() << ")";
+    LOG_DEBUG("session", "Session: received unimplemented opcode {}({})", LookupOpcodeName(recvPacket.GetOpcode()), recvPacket.GetOpcode());
+}
+
+void Session::Handle_EarlyProcess(Packet& recvPacket)
+{
+    LOG_ERROR("session", "Session: received opcode {}({}) that the socket handles, it should never get here", LookupOpcodeName(recvPacket.GetOpcode()), recvPacket.GetOpcode());
+}
+
+void Session::HandlePing(Packet& recvPacket)
+{
+    uint32 serial;
+    recvPacket >> serial;
+
+    if (recvPacket.HasReadError())
+        return;
+
+    Packet pong(SMSG_PONG, 4);
+    pong << serial;
+    SendPacket(std::move(pong));
 }
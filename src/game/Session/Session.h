@@ -16,18 +16,44 @@
 #include "Server.h"
 #include "Define.h"
 #include "Socket.h"
+#include "PacketPool.h"
+#include "SPSCQueue.h"
 
 #define SOCKET_TIMEOUT 30000
+// received packets waiting for the update, a client that gets this far ahead is kicked
+#define SESSION_RECV_QUEUE_SIZE 1024
 
 class Packet;
 
+/// The two passes of Server::UpdateSessions, see PacketProcessing
+enum SessionUpdatePass
+{
+    UPDATE_PASS_PARALLEL,                                   // thread-safe packets only, any update thread
+    UPDATE_PASS_SERIAL                                      // everything else, world thread
+};
+
+/// Lets an update pass take only the packets it may handle
+class PacketFilter
+{
+    public:
+        explicit PacketFilter(SessionUpdatePass pass) : _pass(pass) { }
+
+        bool Process(Packet* packet) const;
+
+    private:
+        SessionUpdatePass _pass;
+};
+
 class Session
 {
     public:
         Session(uint32 id, std::string&& name, std::shared_ptr<Socket> sock);
         ~Session();
 
-        bool Update(uint32 diff);
+        /// budget is shared by both passes of a tick, the serial pass starts the next one
+        bool Update(uint32 diff, SessionBudget const& budget, SessionUpdatePass pass = UPDATE_PASS_SERIAL);
+        /// After the serial pass: the budget ran out and packets were left for the next tick
+        bool IsOverBudget() const { return _overBudget; }
 
         uint32 GetAccountId() const { return m_accountId; }
         std::string const& GetAccountName() const { return m_accountName; }
@@ -51,10 +77,22 @@ class Session
         }
 
         void SendPacket(Packet const* packet);
-        void QueuePacket(Packet* packet);
+        void SendPacket(Packet&& packet);
+        /// Network thread: false when the receive queue is full, the caller drops the client
+        bool QueuePacket(Packet&& packet);
+        /// Network thread: handles a PROCESS_INPLACE packet at once, false when it was malformed and the caller drops the client
+        bool HandleInplacePacket(Packet& packet);
 
         void Handle_NULL(Packet& recvPacket);
+        void Handle_EarlyProcess(Packet& recvPacket);       // unauthed PROCESS_INPLACE opcodes, handled by Socket
+        void HandlePing(Packet& recvPacket);
     private:
+        /// Runs the handler of packet, false when it turned out malformed (the packet is dumped then)
+        bool CallHandler(Packet& packet, uint64& elapsed);
+        /// Returns the nanoseconds spent in the handler
+        uint64 HandlePacket(Packet* packet);
+        bool HasBudgetLeft(SessionBudget const& budget) const;
+
         std::shared_ptr<Socket> m_Socket;
         std::atomic<int32> m_timeOutTime; // Socket timeout
 
@@ -65,7 +103,12 @@ class Session
 
         bool m_forceExit;
 
-        LockedQueue<Packet*> _recvQueue;
+        SPSCQueue<Packet*> _recvQueue;                      // network thread -> update
+        PacketPool _packetPool;
+
+        uint32 _spentCost;                                  // of the budget, this tick
+        uint64 _spentTime;                                  // nanoseconds
+        bool _overBudget;
 
         // Disable copy
         Session(Session const& right) = delete;
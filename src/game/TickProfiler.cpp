@@ -0,0 +1,110 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "TickProfiler.h"
+#include "Timer.h"
+#include "Log.h"
+#include "Metrics.h"
+
+#include <iomanip>
+
+TickProfiler::TickProfiler() : _slowTickThreshold(0), _tickStart(0), _phaseStart(0), _slowTicks(0)
+{
+    for (uint32 i = 0; i < MAX_TICK_PHASES; ++i)
+        _phases[i] = 0;
+}
+
+char const* TickProfiler::GetPhaseName(TickPhase phase)
+{
+    switch (phase)
+    {
+        case TICK_PHASE_DATABASE: return "database callbacks";
+        case TICK_PHASE_NEW_SESSIONS: return "new sessions";
+        case TICK_PHASE_PARALLEL: return "parallel pass";
+        case TICK_PHASE_DEFERRED: return "deferred tasks";
+        case TICK_PHASE_SERIAL: return "serial pass";
+        default: return "unknown";
+    }
+}
+
+void TickProfiler::BeginTick()
+{
+    _tickStart = getNSTime();
+    _phaseStart = _tickStart;
+
+    for (uint32 i = 0; i < MAX_TICK_PHASES; ++i)
+        _phases[i] = 0;
+}
+
+void TickProfiler::EndPhase(TickPhase phase)
+{
+    uint64 now = getNSTime();
+    _phases[phase] += now - _phaseStart;
+    _phaseStart = now;
+}
+
+void TickProfiler::EndTick()
+{
+    uint64 total = getNSTime() - _tickStart;
+    _tickTimes.Record(total);
+
+    for (uint32 i = 0; i < MAX_TICK_PHASES; ++i)
+        _phaseTimes[i].Record(_phases[i]);
+
+    if (!_slowTickThreshold || total < uint64(_slowTickThreshold) * 1000000)
+        return;
+
+    ++_slowTicks;
+
+    LOG_WARN("server", "TickProfiler: slow tick, {}us: {} {}us, {} {}us, {} {}us, {} {}us, {} {}us", total / 1000,
+        GetPhaseName(TICK_PHASE_DATABASE), _phases[TICK_PHASE_DATABASE] / 1000,
+        GetPhaseName(TICK_PHASE_NEW_SESSIONS), _phases[TICK_PHASE_NEW_SESSIONS] / 1000,
+        GetPhaseName(TICK_PHASE_PARALLEL), _phases[TICK_PHASE_PARALLEL] / 1000,
+        GetPhaseName(TICK_PHASE_DEFERRED), _phases[TICK_PHASE_DEFERRED] / 1000,
+        GetPhaseName(TICK_PHASE_SERIAL), _phases[TICK_PHASE_SERIAL] / 1000);
+}
+
+void TickProfiler::Dump(std::ostream& stream) const
+{
+    stream << "Tick statistics (microseconds), " << _tickTimes.GetCount() << " ticks, " << GetSlowTicks() << " slow:" << std::endl;
+    stream << std::left << std::setw(20) << "phase" << std::right
+        << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(10) << "max" << std::endl;
+
+    for (uint32 i = 0; i <= MAX_TICK_PHASES; ++i)
+    {
+        Histogram const& times = i < MAX_TICK_PHASES ? _phaseTimes[i] : _tickTimes;
+        stream << std::left << std::setw(20) << (i < MAX_TICK_PHASES ? GetPhaseName(TickPhase(i)) : "whole tick") << std::right
+            << std::setw(10) << times.GetMean() / 1000 << std::setw(10) << times.GetPercentile(50.0) / 1000
+            << std::setw(10) << times.GetPercentile(99.0) / 1000 << std::setw(10) << times.GetPercentile(99.9) / 1000
+            << std::setw(10) << times.GetMax() / 1000 << std::endl;
+    }
+}
+
+void TickProfiler::WriteMetrics(MetricsWriter& writer) const
+{
+    writer.Header("ships_tick_seconds", "Duration of Server::Update", "summary");
+    writer.Summary("ships_tick_seconds", nullptr, _tickTimes, 1e-9);
+
+    writer.Header("ships_tick_phase_seconds", "Duration of each phase of Server::Update", "summary");
+    for (uint32 i = 0; i < MAX_TICK_PHASES; ++i)
+    {
+        std::string labels = std::string("phase=\"") + GetPhaseName(TickPhase(i)) + "\"";
+        writer.Summary("ships_tick_phase_seconds", labels.c_str(), _phaseTimes[i], 1e-9);
+    }
+
+    writer.Header("ships_slow_ticks_total", "Ticks over the slow tick threshold", "counter");
+    writer.Sample("ships_slow_ticks_total", nullptr, GetSlowTicks());
+}
@@ -0,0 +1,83 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __TICKPROFILER_H
+#define __TICKPROFILER_H
+
+#include "Define.h"
+#include "Histogram.h"
+
+#include <atomic>
+#include <ostream>
+
+class MetricsWriter;
+
+/// Parts of Server::Update, in the order they run
+enum TickPhase
+{
+    TICK_PHASE_DATABASE,                                    // callbacks of finished database statements
+    TICK_PHASE_NEW_SESSIONS,
+    TICK_PHASE_PARALLEL,                                    // thread-safe packets on the update pool
+    TICK_PHASE_DEFERRED,                                    // tasks queued by the parallel pass
+    TICK_PHASE_SERIAL,                                      // everything else, session removal
+    MAX_TICK_PHASES
+};
+
+/**
+  * Times each Server::Update and its phases.
+  * World thread only: BeginTick(), EndPhase() once after each phase, EndTick(). Whatever
+  * ran since the previous mark is charged to the phase. Tick and phase times go into
+  * histograms (nanoseconds, readable from any thread), ticks slower than the threshold
+  * are logged with their breakdown.
+*/
+class TickProfiler
+{
+    public:
+        TickProfiler();
+
+        /// In milliseconds, 0 logs no slow ticks
+        void SetSlowTickThreshold(uint32 threshold) { _slowTickThreshold = threshold; }
+
+        void BeginTick();
+        void EndPhase(TickPhase phase);
+        void EndTick();
+
+        Histogram const& GetTickTimes() const { return _tickTimes; }
+        Histogram const& GetPhaseTimes(TickPhase phase) const { return _phaseTimes[phase]; }
+        uint64 GetSlowTicks() const { return _slowTicks.load(std::memory_order_relaxed); }
+
+        /// Percentiles of whole ticks and of each phase
+        void Dump(std::ostream& stream) const;
+        /// Tick and phase summaries plus the slow tick count, for the metrics endpoint
+        void WriteMetrics(MetricsWriter& writer) const;
+
+        static char const* GetPhaseName(TickPhase phase);
+
+    private:
+        uint32 _slowTickThreshold;
+        uint64 _tickStart;
+        uint64 _phaseStart;
+        uint64 _phases[MAX_TICK_PHASES];                    // of the current tick
+        std::atomic<uint64> _slowTicks;
+
+        Histogram _tickTimes;
+        Histogram _phaseTimes[MAX_TICK_PHASES];
+
+        TickProfiler(TickProfiler const& right) = delete;
+        TickProfiler& operator=(TickProfiler const& right) = delete;
+};
+
+#endif
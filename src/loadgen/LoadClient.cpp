@@ -0,0 +1,298 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "LoadClient.h"
+#include "Packet.h"
+#include "Headers.h"
+#include "PacketFramer.h"
+#include "Opcodes.h"
+#include "Timer.h"
+
+#include <boost/asio/write.hpp>
+
+#include <cstring>
+
+#define LOADGEN_READ_SIZE 4096
+
+LoadClient::LoadClient(boost::asio::io_service& service, LoadConfig const& config, LoadStats& stats, uint32 id) :
+    _config(config), _stats(stats), _id(id), _state(STATE_CONNECTING), _socket(service), _timer(service), _random(id),
+    _gap(config.rate > 0.0 ? config.rate : 1.0), _readBuffer(LOADGEN_READ_SIZE), _writeActive(false), _connectTime(0), _serial(0)
+{
+    std::vector<double> weights;
+    for (OpcodeWeight const& entry : config.mix)
+        weights.push_back(double(entry.weight));
+
+    _pick = std::discrete_distribution<size_t>(weights.begin(), weights.end());
+}
+
+void LoadClient::Start(tcp::endpoint const& endpoint)
+{
+    _connectTime = getNSTime();
+
+    std::shared_ptr<LoadClient> self = shared_from_this();
+    _socket.async_connect(endpoint, [self](boost::system::error_code error) { self->ConnectHandler(error); });
+
+    _timer.expires_from_now(std::chrono::seconds(_config.handshakeTimeout));
+    _timer.async_wait([self](boost::system::error_code error)
+    {
+        if (error || self->_state == STATE_RUNNING || self->_state == STATE_CLOSED)
+            return;
+
+        if (self->_state == STATE_CONNECTING)
+            ++self->_stats.connectFailed;
+        else
+            ++self->_stats.authFailed;
+
+        self->Close();
+    });
+}
+
+void LoadClient::Stop()
+{
+    Close();
+}
+
+void LoadClient::ConnectHandler(boost::system::error_code error)
+{
+    if (_state == STATE_CLOSED)
+        return;
+
+    if (error)
+    {
+        ++_stats.connectFailed;
+        Close();
+        return;
+    }
+
+    ++_stats.connected;
+
+    boost::system::error_code ignored;
+    _socket.set_option(tcp::no_delay(true), ignored);
+
+    AsyncRead();
+    SendAuth(_config.registration ? CMSG_REGISTRATION : CMSG_AUTH);
+}
+
+void LoadClient::AsyncRead()
+{
+    _readBuffer.Normalize();
+    _readBuffer.EnsureFreeSpace();
+
+    std::shared_ptr<LoadClient> self = shared_from_this();
+    _socket.async_read_some(boost::asio::buffer(_readBuffer.GetWritePointer(), _readBuffer.GetRemainingSpace()),
+        [self](boost::system::error_code error, size_t transferredBytes) { self->ReadHandler(error, transferredBytes); });
+}
+
+void LoadClient::ReadHandler(boost::system::error_code error, size_t transferredBytes)
+{
+    if (_state == STATE_CLOSED)
+        return;
+
+    if (error)
+    {
+        // the server hung up, during the handshake that is a refused login
+        if (_state == STATE_RUNNING)
+            ++_stats.disconnected;
+        else
+            ++_stats.authFailed;
+
+        Close();
+        return;
+    }
+
+    _readBuffer.WriteCompleted(transferredBytes);
+    _stats.bytesReceived += transferredBytes;
+
+    // cut out every complete packet, a partial one waits for the next read
+    while (_readBuffer.GetActiveSize() >= sizeof(ServerHeader))
+    {
+        ServerHeader header;
+        std::memcpy(&header, _readBuffer.GetReadPointer(), sizeof(header));
+        if (_readBuffer.GetActiveSize() < sizeof(header) + header.Size)
+        {
+            if (_readBuffer.GetBufferSize() < sizeof(header) + header.Size)
+            {
+                _readBuffer.Normalize();
+                _readBuffer.Resize(sizeof(header) + header.Size);
+            }
+            break;
+        }
+
+        Packet packet(header.Command, header.Size);
+        if (header.Size)
+            packet.append(_readBuffer.GetReadPointer() + sizeof(header), header.Size);
+        _readBuffer.ReadCompleted(sizeof(header) + header.Size);
+
+        ++_stats.packetsReceived;
+        HandlePacket(header.Command, packet);
+        if (_state == STATE_CLOSED)
+            return;
+    }
+
+    AsyncRead();
+}
+
+void LoadClient::HandlePacket(uint32 opcode, Packet& packet)
+{
+    switch (opcode)
+    {
+        case SMSG_REGISTRATION_RESPONSE:
+            // a refused registration may be an account left from an earlier run, the login decides
+            if (_state == STATE_REGISTERING)
+                SendAuth(CMSG_AUTH);
+            break;
+        case SMSG_AUTH_RESPONSE:
+            // the server drops a refused login, so any answer counts as accepted
+            if (_state == STATE_AUTHING)
+                OnAuthed();
+            break;
+        case SMSG_PONG:
+        {
+            uint32 serial;
+            packet >> serial;
+
+            // pongs come back in order, anything before serial was lost
+            uint64 now = getNSTime();
+            while (!_pings.empty() && _pings.front().first != serial)
+                _pings.pop_front();
+
+            if (!_pings.empty())
+            {
+                _stats.pingTime.Record(now - _pings.front().second);
+                _pings.pop_front();
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void LoadClient::SendAuth(uint32 opcode)
+{
+    _state = opcode == CMSG_REGISTRATION ? STATE_REGISTERING : STATE_AUTHING;
+
+    std::string account = _config.accountPrefix + std::to_string(_id);
+    Packet packet(opcode);
+    packet << account;
+    packet << account;                                      // password
+    Send(packet);
+}
+
+void LoadClient::OnAuthed()
+{
+    _state = STATE_RUNNING;
+    ++_stats.authed;
+    _stats.handshakeTime.Record(getNSTime() - _connectTime);
+
+    _timer.cancel();
+    ScheduleNext();
+}
+
+void LoadClient::ScheduleNext()
+{
+    if (_config.mix.empty() || _config.rate <= 0.0)
+        return;
+
+    std::shared_ptr<LoadClient> self = shared_from_this();
+    _timer.expires_from_now(std::chrono::microseconds(uint64(_gap(_random) * 1000000.0)));
+    _timer.async_wait([self](boost::system::error_code error)
+    {
+        if (error || self->_state != STATE_RUNNING)
+            return;
+
+        self->SendNext();
+        self->ScheduleNext();
+    });
+}
+
+void LoadClient::SendNext()
+{
+    uint16 opcode = _config.mix[_pick(_random)].opcode;
+    Packet packet(opcode);
+
+    switch (opcode)
+    {
+        case CMSG_PING:
+            packet << ++_serial;
+            _pings.push_back(std::make_pair(_serial, getNSTime()));
+            break;
+        default:
+            // no payload is known for it, the handler sees an empty packet
+            break;
+    }
+
+    Send(packet);
+}
+
+void LoadClient::Send(Packet const& packet)
+{
+    ClientHeader header;
+    header.Command = uint16(packet.GetOpcode());
+    header.Size = uint16(packet.size());
+
+    uint8 const* headerBytes = reinterpret_cast<uint8 const*>(&header);
+    _writeBuffer.insert(_writeBuffer.end(), headerBytes, headerBytes + sizeof(header));
+    if (!packet.empty())
+        _writeBuffer.insert(_writeBuffer.end(), packet.contents(), packet.contents() + packet.size());
+
+    ++_stats.packetsSent;
+    _stats.bytesSent += sizeof(header) + packet.size();
+
+    if (!_writeActive)
+        AsyncWrite();
+}
+
+void LoadClient::AsyncWrite()
+{
+    // whatever was queued meanwhile goes out as one write
+    _writing.swap(_writeBuffer);
+    _writeBuffer.clear();
+    _writeActive = true;
+
+    std::shared_ptr<LoadClient> self = shared_from_this();
+    boost::asio::async_write(_socket, boost::asio::buffer(_writing),
+        [self](boost::system::error_code error, size_t transferredBytes) { self->WriteHandler(error, transferredBytes); });
+}
+
+void LoadClient::WriteHandler(boost::system::error_code error, size_t /*transferredBytes*/)
+{
+    _writeActive = false;
+    if (_state == STATE_CLOSED)
+        return;
+
+    if (error)
+    {
+        Close();
+        return;
+    }
+
+    if (!_writeBuffer.empty())
+        AsyncWrite();
+}
+
+void LoadClient::Close()
+{
+    if (_state == STATE_CLOSED)
+        return;
+
+    _state = STATE_CLOSED;
+    _timer.cancel();
+
+    boost::system::error_code ignored;
+    _socket.shutdown(tcp::socket::shutdown_both, ignored);
+    _socket.close(ignored);
+}
@@ -0,0 +1,96 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LOADCLIENT_H
+#define LOADCLIENT_H
+
+#include "Define.h"
+#include "LoadGen.h"
+#include "MessageBuffer.h"
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <deque>
+#include <memory>
+#include <random>
+
+using boost::asio::ip::tcp;
+
+class Packet;
+
+/**
+  * One simulated player: connects, runs the handshake, then sends the opcode mix at
+  * LoadConfig::rate with exponentially distributed gaps until stopped.
+  * All of its handlers run on the io_service of its worker, one thread, so nothing is locked.
+*/
+class LoadClient : public std::enable_shared_from_this<LoadClient>
+{
+public:
+    LoadClient(boost::asio::io_service& service, LoadConfig const& config, LoadStats& stats, uint32 id);
+
+    void Start(tcp::endpoint const& endpoint);
+    void Stop();
+
+private:
+    enum State
+    {
+        STATE_CONNECTING,
+        STATE_REGISTERING,
+        STATE_AUTHING,
+        STATE_RUNNING,
+        STATE_CLOSED
+    };
+
+    void ConnectHandler(boost::system::error_code error);
+    void AsyncRead();
+    void ReadHandler(boost::system::error_code error, size_t transferredBytes);
+    void HandlePacket(uint32 opcode, Packet& packet);
+
+    void SendAuth(uint32 opcode);
+    void OnAuthed();
+    void ScheduleNext();
+    void SendNext();
+
+    void Send(Packet const& packet);
+    void AsyncWrite();
+    void WriteHandler(boost::system::error_code error, size_t transferredBytes);
+
+    void Close();
+
+    LoadConfig const& _config;
+    LoadStats& _stats;
+    uint32 _id;
+    State _state;
+
+    tcp::socket _socket;
+    boost::asio::steady_timer _timer;                       // handshake timeout, then the next send
+    std::mt19937 _random;
+    std::exponential_distribution<double> _gap;             // seconds between sends
+    std::discrete_distribution<size_t> _pick;               // index into LoadConfig::mix
+
+    MessageBuffer _readBuffer;
+    std::vector<uint8> _writeBuffer;                        // packets queued while a write is in flight
+    std::vector<uint8> _writing;
+    bool _writeActive;
+
+    uint64 _connectTime;
+    uint32 _serial;
+    std::deque<std::pair<uint32, uint64>> _pings;           // serial and send time, answered in order
+};
+
+#endif
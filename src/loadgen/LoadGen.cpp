@@ -0,0 +1,76 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "LoadGen.h"
+#include "Opcodes.h"
+
+#include <cstdlib>
+#include <sstream>
+
+LoadStats::LoadStats() : connected(0), connectFailed(0), authed(0), authFailed(0), disconnected(0),
+    packetsSent(0), bytesSent(0), packetsReceived(0), bytesReceived(0)
+{
+}
+
+bool ParseOpcodeMix(std::string const& text, std::vector<OpcodeWeight>& mix, std::string& error)
+{
+    mix.clear();
+
+    std::istringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (item.empty())
+            continue;
+
+        std::string name = item;
+        uint32 weight = 1;
+        size_t colon = item.find(':');
+        if (colon != std::string::npos)
+        {
+            name = item.substr(0, colon);
+            weight = uint32(std::strtoul(item.c_str() + colon + 1, nullptr, 10));
+        }
+
+        uint32 opcode = 0;
+        while (opcode < NUM_MSG_TYPES && name != opcodeTable[opcode].name)
+            ++opcode;
+
+        if (opcode == NUM_MSG_TYPES)
+        {
+            error = "unknown opcode " + name;
+            return false;
+        }
+
+        // only what an authenticated client may send, anything else gets the connection closed
+        if (opcodeTable[opcode].status != STATUS_AUTHED)
+        {
+            error = name + " can not be sent after authentication";
+            return false;
+        }
+
+        if (weight)
+            mix.push_back(OpcodeWeight(uint16(opcode), weight));
+    }
+
+    if (mix.empty())
+    {
+        error = "empty opcode mix";
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,79 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LOADGEN_H
+#define LOADGEN_H
+
+#include "Define.h"
+#include "Histogram.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+/// One entry of the opcode mix, sent with probability weight / sum of all weights
+struct OpcodeWeight
+{
+    OpcodeWeight(uint16 opcode_, uint32 weight_) : opcode(opcode_), weight(weight_) { }
+
+    uint16 opcode;
+    uint32 weight;
+};
+
+struct LoadConfig
+{
+    LoadConfig() : host("127.0.0.1"), port(8085), connections(1000), threads(4), duration(60), connectRate(500),
+        rate(10.0), registration(false), handshakeTimeout(10), accountPrefix("loadgen") { }
+
+    std::string host;
+    uint16 port;
+    uint32 connections;
+    uint32 threads;                                         // io threads, each owns connections / threads clients
+    uint32 duration;                                        // seconds of traffic after the first connect
+    uint32 connectRate;                                     // new connections per second over all threads, 0 connects all at once
+    double rate;                                            // packets per second per authenticated connection
+    bool registration;                                      // CMSG_REGISTRATION before CMSG_AUTH
+    uint32 handshakeTimeout;                                // seconds
+    std::string accountPrefix;                              // accounts are <prefix><client id>
+    std::vector<OpcodeWeight> mix;
+};
+
+/**
+  * Counters of one worker. Only its io thread writes them, the reporting thread reads them
+  * while the test runs (Histogram allows one writer and concurrent readers).
+*/
+struct LoadStats
+{
+    LoadStats();
+
+    std::atomic<uint64> connected;
+    std::atomic<uint64> connectFailed;
+    std::atomic<uint64> authed;
+    std::atomic<uint64> authFailed;
+    std::atomic<uint64> disconnected;                       // closed by the server after the handshake
+    std::atomic<uint64> packetsSent;
+    std::atomic<uint64> bytesSent;
+    std::atomic<uint64> packetsReceived;
+    std::atomic<uint64> bytesReceived;
+
+    Histogram handshakeTime;                                // ns, connect to SMSG_AUTH_RESPONSE
+    Histogram pingTime;                                     // ns, CMSG_PING to the SMSG_PONG of its serial
+};
+
+/// Parses "CMSG_PING:8,CMSG_FOO:2" (weight defaults to 1), false with error set on unknown or server-only opcodes
+bool ParseOpcodeMix(std::string const& text, std::vector<OpcodeWeight>& mix, std::string& error);
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "LoadWorker.h"
+#include "LoadClient.h"
+#include "Timer.h"
+
+#include <algorithm>
+
+// connects are started in batches this often
+#define LOADGEN_CONNECT_INTERVAL 10
+
+LoadWorker::LoadWorker(LoadConfig const& config, uint32 firstId, uint32 clients, uint32 connectRate) :
+    _config(config), _firstId(firstId), _clientCount(clients), _connectRate(connectRate), _startTime(0),
+    _connectTimer(_service), _thread(nullptr)
+{
+}
+
+LoadWorker::~LoadWorker()
+{
+    Stop();
+}
+
+void LoadWorker::Start(boost::asio::ip::tcp::endpoint const& endpoint)
+{
+    _endpoint = endpoint;
+    _startTime = getNSTime();
+    _clients.reserve(_clientCount);
+    _work.reset(new boost::asio::io_service::work(_service));
+
+    _service.post([this]() { ConnectMore(); });
+    _thread = new std::thread([this]() { _service.run(); });
+}
+
+void LoadWorker::ConnectMore()
+{
+    // as many as the rate allows by now, so a late timer catches up
+    uint64 due = _clientCount;
+    if (_connectRate)
+        due = std::min<uint64>(_clientCount, (getNSTime() - _startTime) * _connectRate / 1000000000 + 1);
+
+    while (_clients.size() < due)
+    {
+        std::shared_ptr<LoadClient> client = std::make_shared<LoadClient>(_service, _config, _stats, _firstId + uint32(_clients.size()));
+        client->Start(_endpoint);
+        _clients.push_back(client);
+    }
+
+    if (_clients.size() == _clientCount)
+        return;
+
+    _connectTimer.expires_from_now(std::chrono::milliseconds(LOADGEN_CONNECT_INTERVAL));
+    _connectTimer.async_wait([this](boost::system::error_code error)
+    {
+        if (!error)
+            ConnectMore();
+    });
+}
+
+void LoadWorker::Stop()
+{
+    if (!_thread)
+        return;
+
+    _service.post([this]()
+    {
+        _connectTimer.cancel();
+        for (std::shared_ptr<LoadClient> const& client : _clients)
+            client->Stop();
+    });
+
+    // run() returns once the closed clients' handlers are done
+    _work.reset();
+    _thread->join();
+    delete _thread;
+    _thread = nullptr;
+    _clients.clear();
+}
@@ -0,0 +1,64 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LOADWORKER_H
+#define LOADWORKER_H
+
+#include "Define.h"
+#include "LoadGen.h"
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+class LoadClient;
+
+/// One io thread and the clients it drives; clients are connected over time at its share of LoadConfig::connectRate
+class LoadWorker
+{
+public:
+    LoadWorker(LoadConfig const& config, uint32 firstId, uint32 clients, uint32 connectRate);
+    ~LoadWorker();
+
+    void Start(boost::asio::ip::tcp::endpoint const& endpoint);
+    /// Closes all clients and joins the thread
+    void Stop();
+
+    LoadStats const& GetStats() const { return _stats; }
+
+private:
+    void ConnectMore();
+
+    LoadConfig const& _config;
+    LoadStats _stats;
+    uint32 _firstId;
+    uint32 _clientCount;
+    uint32 _connectRate;                                    // per second, 0 is all at once
+    uint64 _startTime;
+
+    boost::asio::io_service _service;
+    std::unique_ptr<boost::asio::io_service::work> _work;
+    boost::asio::steady_timer _connectTimer;
+    boost::asio::ip::tcp::endpoint _endpoint;
+    std::vector<std::shared_ptr<LoadClient>> _clients;
+    std::thread* _thread;
+};
+
+#endif
@@ -0,0 +1,220 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "LoadGen.h"
+#include "LoadWorker.h"
+#include "Timer.h"
+
+#include <boost/asio/ip/address.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Sums of all workers at one moment
+struct LoadTotals
+{
+    LoadTotals() : connected(0), connectFailed(0), authed(0), authFailed(0), disconnected(0),
+        packetsSent(0), bytesSent(0), packetsReceived(0), bytesReceived(0) { }
+
+    void Add(LoadStats const& stats)
+    {
+        connected += stats.connected;
+        connectFailed += stats.connectFailed;
+        authed += stats.authed;
+        authFailed += stats.authFailed;
+        disconnected += stats.disconnected;
+        packetsSent += stats.packetsSent;
+        bytesSent += stats.bytesSent;
+        packetsReceived += stats.packetsReceived;
+        bytesReceived += stats.bytesReceived;
+    }
+
+    uint64 connected;
+    uint64 connectFailed;
+    uint64 authed;
+    uint64 authFailed;
+    uint64 disconnected;
+    uint64 packetsSent;
+    uint64 bytesSent;
+    uint64 packetsReceived;
+    uint64 bytesReceived;
+};
+
+static void Usage(char const* name)
+{
+    LoadConfig defaults;
+    std::cout << "Usage: " << name << " [options]" << std::endl
+        << "  --host <ip>            server address (" << defaults.host << ")" << std::endl
+        << "  --port <port>          server port (" << defaults.port << ")" << std::endl
+        << "  --connections <n>      concurrent clients (" << defaults.connections << ")" << std::endl
+        << "  --threads <n>          io threads (" << defaults.threads << ")" << std::endl
+        << "  --duration <s>         length of the run (" << defaults.duration << ")" << std::endl
+        << "  --connect-rate <n>     new connections per second, 0 for all at once (" << defaults.connectRate << ")" << std::endl
+        << "  --rate <n>             packets per second per client (" << defaults.rate << ")" << std::endl
+        << "  --mix <list>           opcode mix as NAME:weight,... (CMSG_PING:1)" << std::endl
+        << "  --register             send CMSG_REGISTRATION before CMSG_AUTH" << std::endl
+        << "  --account-prefix <s>   accounts are <prefix><n> (" << defaults.accountPrefix << ")" << std::endl;
+}
+
+static bool ParseArguments(int argc, char** argv, LoadConfig& config)
+{
+    std::string mix = "CMSG_PING:1";
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--register")
+            config.registration = true;
+        else if (arg == "--host" && hasValue)
+            config.host = argv[++i];
+        else if (arg == "--port" && hasValue)
+            config.port = uint16(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--connections" && hasValue)
+            config.connections = uint32(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--threads" && hasValue)
+            config.threads = uint32(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--duration" && hasValue)
+            config.duration = uint32(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--connect-rate" && hasValue)
+            config.connectRate = uint32(std::strtoul(argv[++i], nullptr, 10));
+        else if (arg == "--rate" && hasValue)
+            config.rate = std::strtod(argv[++i], nullptr);
+        else if (arg == "--mix" && hasValue)
+            mix = argv[++i];
+        else if (arg == "--account-prefix" && hasValue)
+            config.accountPrefix = argv[++i];
+        else
+        {
+            Usage(argv[0]);
+            return false;
+        }
+    }
+
+    std::string error;
+    if (!ParseOpcodeMix(mix, config.mix, error))
+    {
+        std::cerr << "--mix: " << error << std::endl;
+        return false;
+    }
+
+    if (config.threads < 1)
+        config.threads = 1;
+    if (config.threads > config.connections)
+        config.threads = config.connections ? config.connections : 1;
+
+    return true;
+}
+
+static void PrintLatency(char const* name, Histogram const& times)
+{
+    std::cout << std::left << std::setw(12) << name << std::right
+        << std::setw(10) << times.GetCount() << std::setw(10) << times.GetMean() / 1000
+        << std::setw(10) << times.GetPercentile(50.0) / 1000 << std::setw(10) << times.GetPercentile(90.0) / 1000
+        << std::setw(10) << times.GetPercentile(99.0) / 1000 << std::setw(10) << times.GetPercentile(99.9) / 1000
+        << std::setw(10) << times.GetMax() / 1000 << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    LoadConfig config;
+    if (!ParseArguments(argc, argv, config))
+        return 1;
+
+    boost::system::error_code error;
+    boost::asio::ip::address address = boost::asio::ip::address::from_string(config.host, error);
+    if (error)
+    {
+        std::cerr << "--host: " << error.message() << std::endl;
+        return 1;
+    }
+
+    boost::asio::ip::tcp::endpoint endpoint(address, config.port);
+
+    std::cout << "ships_loadgen: " << config.connections << " connections to " << config.host << ":" << config.port
+        << " on " << config.threads << " threads, " << config.rate << " packets/s each for " << config.duration << "s" << std::endl;
+
+    // clients and the connect rate are split evenly, the first workers take the remainder
+    std::vector<std::unique_ptr<LoadWorker>> workers;
+    uint32 firstId = 1;
+    for (uint32 i = 0; i < config.threads; ++i)
+    {
+        uint32 clients = config.connections / config.threads + (i < config.connections % config.threads ? 1 : 0);
+        uint32 connectRate = config.connectRate ? std::max<uint32>(1, config.connectRate / config.threads) : 0;
+        workers.push_back(std::unique_ptr<LoadWorker>(new LoadWorker(config, firstId, clients, connectRate)));
+        firstId += clients;
+    }
+
+    for (std::unique_ptr<LoadWorker>& worker : workers)
+        worker->Start(endpoint);
+
+    // one line per second: state of the connections and the rates of the last second
+    LoadTotals last;
+    uint64 start = getNSTime();
+    for (uint32 second = 1; second <= config.duration; ++second)
+    {
+        int64 wait = int64(start + uint64(second) * 1000000000) - int64(getNSTime());
+        if (wait > 0)
+            std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+
+        LoadTotals now;
+        for (std::unique_ptr<LoadWorker> const& worker : workers)
+            now.Add(worker->GetStats());
+
+        std::cout << std::setw(5) << second << "s"
+            << "  connected " << now.connected << " (" << now.connectFailed << " failed)"
+            << "  authed " << now.authed << " (" << now.authFailed << " failed, " << now.disconnected << " dropped)"
+            << "  sent " << now.packetsSent - last.packetsSent << " pkt/s " << (now.bytesSent - last.bytesSent) / 1024 << " KB/s"
+            << "  received " << now.packetsReceived - last.packetsReceived << " pkt/s " << (now.bytesReceived - last.bytesReceived) / 1024 << " KB/s"
+            << std::endl;
+
+        last = now;
+    }
+
+    for (std::unique_ptr<LoadWorker>& worker : workers)
+        worker->Stop();
+
+    LoadTotals totals;
+    std::unique_ptr<Histogram> handshakeTime(new Histogram());
+    std::unique_ptr<Histogram> pingTime(new Histogram());
+    for (std::unique_ptr<LoadWorker> const& worker : workers)
+    {
+        totals.Add(worker->GetStats());
+        handshakeTime->Merge(worker->GetStats().handshakeTime);
+        pingTime->Merge(worker->GetStats().pingTime);
+    }
+
+    double seconds = double(getNSTime() - start) / 1e9;
+    std::cout << std::endl << "Throughput over " << std::setprecision(3) << seconds << "s: "
+        << uint64(double(totals.packetsSent) / seconds) << " packets/s sent, "
+        << uint64(double(totals.packetsReceived) / seconds) << " packets/s received" << std::endl;
+    std::cout << "Connections: " << totals.connected << " connected, " << totals.connectFailed << " failed to connect, "
+        << totals.authed << " authed, " << totals.authFailed << " refused or timed out, " << totals.disconnected << " dropped" << std::endl;
+
+    std::cout << std::endl << "Latency (microseconds):" << std::endl;
+    std::cout << std::left << std::setw(12) << "" << std::right
+        << std::setw(10) << "count" << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p90"
+        << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(10) << "max" << std::endl;
+    PrintLatency("handshake", *handshakeTime);
+    PrintLatency("ping", *pingTime);
+
+    return 0;
+}
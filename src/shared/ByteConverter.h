@@ -22,6 +22,10 @@
 
 #include "Define.h"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 namespace ByteConverter
 {
     template<size_t T>
@@ -38,6 +42,86 @@ namespace ByteConverter
     {
         convert<sizeof(T)>((char *)(val));
     }
+
+    inline uint16 swap(uint16 val) { return uint16((val >> 8) | (val << 8)); }
+
+    inline uint32 swap(uint32 val)
+    {
+#if COMPILER == COMPILER_GNU
+        return __builtin_bswap32(val);
+#else
+        return (val >> 24) | ((val >> 8) & 0xFF00) | ((val << 8) & 0xFF0000) | (val << 24);
+#endif
+    }
+
+    inline uint64 swap(uint64 val)
+    {
+#if COMPILER == COMPILER_GNU
+        return __builtin_bswap64(val);
+#else
+        return (uint64(swap(uint32(val))) << 32) | swap(uint32(val >> 32));
+#endif
+    }
+
+#if defined(__SSE2__) || defined(_M_X64)
+    // byte swap of every Word lane of a 16 byte vector, SSE2 only (no pshufb)
+    template<typename Word> inline __m128i swapVector(__m128i v);
+
+    template<> inline __m128i swapVector<uint16>(__m128i v)
+    {
+        return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    }
+
+    template<> inline __m128i swapVector<uint32>(__m128i v)
+    {
+        v = swapVector<uint16>(v);
+        return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);
+    }
+
+    template<> inline __m128i swapVector<uint64>(__m128i v)
+    {
+        v = swapVector<uint16>(v);
+        return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0x1B), 0x1B);
+    }
+#endif
+
+    // Swaps count consecutive values of type Word stored at (possibly unaligned) val,
+    // 16 bytes at a time where SSE2 is available
+    template<typename Word> inline void swapArray(uint8 *val, size_t count)
+    {
+        size_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+        size_t const perVector = 16 / sizeof(Word);
+        for (; i + perVector <= count; i += perVector, val += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(val));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(val), swapVector<Word>(v));
+        }
+#endif
+        for (; i < count; ++i, val += sizeof(Word))
+        {
+            Word w;
+            memcpy(&w, val, sizeof(Word));
+            w = swap(w);
+            memcpy(val, &w, sizeof(Word));
+        }
+    }
+
+    template<size_t T> inline void convertArray(uint8 *val, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            convert<T>((char *)(val + i * T));
+    }
+
+    template<> inline void convertArray<1>(uint8 *, size_t) { }
+    template<> inline void convertArray<2>(uint8 *val, size_t count) { swapArray<uint16>(val, count); }
+    template<> inline void convertArray<4>(uint8 *val, size_t count) { swapArray<uint32>(val, count); }
+    template<> inline void convertArray<8>(uint8 *val, size_t count) { swapArray<uint64>(val, count); }
+
+    template<typename T> inline void applyArray(void *val, size_t count)
+    {
+        convertArray<sizeof(T)>((uint8 *)(val), count);
+    }
 }
 
 #if ENDIAN == BIGENDIAN
@@ -45,11 +129,13 @@ template<typename T> inline void EndianConvert(T& val) { ByteConverter::apply<T>
 template<typename T> inline void EndianConvertReverse(T&) { }
 template<typename T> inline void EndianConvertPtr(void* val) { ByteConverter::apply<T>(val); }
 template<typename T> inline void EndianConvertPtrReverse(void*) { }
+template<typename T> inline void EndianConvertArray(void* val, size_t count) { ByteConverter::applyArray<T>(val, count); }
 #else
 template<typename T> inline void EndianConvert(T&) { }
 template<typename T> inline void EndianConvertReverse(T& val) { ByteConverter::apply<T>(&val); }
 template<typename T> inline void EndianConvertPtr(void*) { }
 template<typename T> inline void EndianConvertPtrReverse(void* val) { ByteConverter::apply<T>(val); }
+template<typename T> inline void EndianConvertArray(void*, size_t) { }
 #endif
 
 template<typename T> void EndianConvert(T*);         // will generate link error
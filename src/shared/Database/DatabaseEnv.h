@@ -21,6 +21,7 @@
 #endif
 
 #include "MySQLConnection.h"
+#include "DatabaseWorkerPool.h"
 #include <mysql.h>
 
 #define _LIKE_           "LIKE"
@@ -28,7 +29,7 @@
 #define _CONCAT3_(A, B, C) "CONCAT( " A ", " B ", " C " )"
 #define _OFFSET_         "LIMIT %d, 1"
 
-extern MySQLConnection Database;
+extern DatabaseWorkerPool Database;
 
 #endif
 
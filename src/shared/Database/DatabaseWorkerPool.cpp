@@ -0,0 +1,167 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "DatabaseWorkerPool.h"
+#include "Metrics.h"
+#include "Log.h"
+
+#include <chrono>
+#include <mutex>
+
+// an idle connection is pinged this often so the server does not drop it (wait_timeout)
+#define DATABASE_PING_INTERVAL 60
+
+static MetricGauge& QueuedTasks()
+{
+    static MetricGauge& queued = sMetrics->GetGauge("ships_db_queue", "MySQL statements waiting for a worker");
+    return queued;
+}
+
+DatabaseWorkerPool::DatabaseWorkerPool()
+{
+}
+
+DatabaseWorkerPool::~DatabaseWorkerPool()
+{
+    Close();
+}
+
+bool DatabaseWorkerPool::Open(MySQLConnectionInfo const& connectionInfo, uint32 connections, std::function<void()>&& callbackSignal)
+{
+    // mysql_init() would do it too, but not thread-safely
+    static std::once_flag libraryInit;
+    std::call_once(libraryInit, []() { mysql_library_init(0, nullptr, nullptr); });
+
+    for (uint32 i = 0; i < connections; ++i)
+    {
+        std::unique_ptr<MySQLConnection> connection(new MySQLConnection());
+        if (!connection->Open(connectionInfo))
+        {
+            LOG_ERROR("sql", "DatabaseWorkerPool: could not open connection {} of {} to {}", i + 1, connections, connectionInfo.database);
+            _connections.clear();
+            return false;
+        }
+
+        _connections.push_back(std::move(connection));
+    }
+
+    // before any worker exists, starting the threads publishes it to them
+    _callbackSignal = std::move(callbackSignal);
+
+    for (std::unique_ptr<MySQLConnection>& connection : _connections)
+        _workers.push_back(std::thread(&DatabaseWorkerPool::WorkerThread, this, connection.get()));
+
+    LOG_INFO("sql", "DatabaseWorkerPool: {} connections to {} open", connections, connectionInfo.database);
+    return true;
+}
+
+void DatabaseWorkerPool::Close()
+{
+    if (_workers.empty())
+        return;
+
+    // behind everything queued, one for each worker
+    for (size_t i = 0; i < _workers.size(); ++i)
+        _tasks.add(Task());
+
+    for (std::thread& worker : _workers)
+        worker.join();
+
+    // what the last statements reported, e.g. save confirmations, is not lost
+    ProcessCallbacks();
+
+    _workers.clear();
+    _connections.clear();
+    _callbackSignal = std::function<void()>();
+}
+
+void DatabaseWorkerPool::Execute(std::string const& sql)
+{
+    Enqueue([sql](MySQLConnection& connection) { connection.Execute(sql.c_str()); });
+}
+
+void DatabaseWorkerPool::AsyncExecute(std::string const& sql, ExecuteCallback&& callback)
+{
+    Enqueue([this, sql, callback](MySQLConnection& connection)
+    {
+        bool success = connection.Execute(sql.c_str());
+        AddCallback([callback, success]() { callback(success); });
+    });
+}
+
+void DatabaseWorkerPool::AsyncQuery(std::string const& sql, QueryCallback&& callback)
+{
+    Enqueue([this, sql, callback](MySQLConnection& connection)
+    {
+        QueryResult result = connection.Query(sql.c_str());
+        AddCallback([callback, result]() { callback(result); });
+    });
+}
+
+std::future<QueryResult> DatabaseWorkerPool::AsyncQuery(std::string const& sql)
+{
+    std::shared_ptr<std::promise<QueryResult>> promise = std::make_shared<std::promise<QueryResult>>();
+    Enqueue([sql, promise](MySQLConnection& connection) { promise->set_value(connection.Query(sql.c_str())); });
+    return promise->get_future();
+}
+
+void DatabaseWorkerPool::ProcessCallbacks()
+{
+    if (!_callbacks.drain(_runningCallbacks))
+        return;
+
+    for (std::function<void()>& callback : _runningCallbacks)
+        callback();
+
+    _runningCallbacks.clear();
+}
+
+void DatabaseWorkerPool::Enqueue(Task const& task)
+{
+    QueuedTasks().Add(1);
+    _tasks.add(task);
+}
+
+void DatabaseWorkerPool::AddCallback(std::function<void()> const& callback)
+{
+    _callbacks.add(callback);
+    if (_callbackSignal)
+        _callbackSignal();
+}
+
+void DatabaseWorkerPool::WorkerThread(MySQLConnection* connection)
+{
+    mysql_thread_init();
+
+    Task task;
+    for (;;)
+    {
+        if (!_tasks.wait_next(task, std::chrono::seconds(DATABASE_PING_INTERVAL)))
+        {
+            if (*connection)
+                connection->Ping();
+            continue;
+        }
+
+        if (!task)
+            break;
+
+        QueuedTasks().Add(-1);
+        task(*connection);
+    }
+
+    mysql_thread_end();
+}
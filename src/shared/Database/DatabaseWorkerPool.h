@@ -0,0 +1,95 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DATABASEWORKERPOOL_H
+#define DATABASEWORKERPOOL_H
+
+#include "Define.h"
+#include "LockedQueue.h"
+#include "MySQLConnection.h"
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+  * Connections to one database, each used by a worker thread of its own.
+  * Statements are queued and taken by whichever worker is free, so the caller never waits
+  * for MySQL. Results come back either through a future or through a callback that
+  * ProcessCallbacks() runs on the world thread, from Server::Update.
+  *
+  *     Database.AsyncQuery("SELECT ...", [](QueryResult result) { ... });   // runs during a later tick
+*/
+class DatabaseWorkerPool
+{
+    public:
+        typedef std::function<void(QueryResult)> QueryCallback;
+        typedef std::function<void(bool)> ExecuteCallback;
+
+        DatabaseWorkerPool();
+        ~DatabaseWorkerPool();
+
+        /**
+          * Opens connections and starts a worker for each, false when any connection failed.
+          * callbackSignal, if set, is called from a worker whenever a callback is ready, e.g. to wake
+          * the world thread; the workers read it unlocked, so it is fixed until Close().
+        */
+        bool Open(MySQLConnectionInfo const& connectionInfo, uint32 connections, std::function<void()>&& callbackSignal = std::function<void()>());
+        /// Runs everything queued so far and the callbacks of it, then stops the workers and closes the connections.
+        /// Called from the world thread, after its last tick.
+        void Close();
+
+        /// Queued, the result is not reported
+        void Execute(std::string const& sql);
+        /// Queued, callback(success) runs in ProcessCallbacks()
+        void AsyncExecute(std::string const& sql, ExecuteCallback&& callback);
+        /// Queued, callback(result) runs in ProcessCallbacks(); result is null for no rows or an error
+        void AsyncQuery(std::string const& sql, QueryCallback&& callback);
+        /// Queued, the future is ready once a worker has run it. Never wait for it on the world thread.
+        std::future<QueryResult> AsyncQuery(std::string const& sql);
+
+        /// Queues the query and waits for it, for startup and tools only
+        QueryResult DirectQuery(std::string const& sql) { return AsyncQuery(sql).get(); }
+
+        /// World thread: runs the callbacks of the finished statements
+        void ProcessCallbacks();
+
+        bool IsOpen() const { return !_workers.empty(); }
+
+    private:
+        /// An empty task stops the worker taking it
+        typedef std::function<void(MySQLConnection&)> Task;
+
+        void Enqueue(Task const& task);
+        void AddCallback(std::function<void()> const& callback);
+        void WorkerThread(MySQLConnection* connection);
+
+        std::vector<std::unique_ptr<MySQLConnection>> _connections;
+        std::vector<std::thread> _workers;
+
+        LockedQueue<Task> _tasks;
+        LockedQueue<std::function<void()>> _callbacks;
+        LockedQueue<std::function<void()>>::storage_type _runningCallbacks;  // swapped with _callbacks each tick
+        std::function<void()> _callbackSignal;
+
+        DatabaseWorkerPool(DatabaseWorkerPool const& right) = delete;
+        DatabaseWorkerPool& operator=(DatabaseWorkerPool const& right) = delete;
+};
+
+#endif
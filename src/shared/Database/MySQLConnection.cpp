@@ -22,14 +22,28 @@
 #include <thread>
 
 #include "MySQLConnection.h"
+#include "Log.h"
+#include "Metrics.h"
 #include <Timer.h>
 
-MySQLConnection::MySQLConnection() : m_Mysql(nullptr), m_connectionInfo(MySQLConnectionInfo()) { }
+// statements sent, with the time until their result was read
+static MetricHistogram& QueryTimes()
+{
+    static MetricHistogram& times = sMetrics->GetHistogram("ships_db_query_seconds", "Time of MySQL statements, result included");
+    return times;
+}
+
+static MetricCounter& QueryErrors()
+{
+    static MetricCounter& errors = sMetrics->GetCounter("ships_db_errors_total", "MySQL statements that failed");
+    return errors;
+}
+
+MySQLConnection::MySQLConnection() : m_reconnecting(false), m_prepareError(false), m_Mysql(nullptr), m_connectionInfo(MySQLConnectionInfo()) { }
 
 MySQLConnection::~MySQLConnection()
 {
-    if (m_Mysql)
-        mysql_close(m_Mysql);
+    Close();
 }
 
 bool MySQLConnection::Open(MySQLConnectionInfo connectInfo)
@@ -40,7 +54,7 @@ bool MySQLConnection::Open(MySQLConnectionInfo connectInfo)
     mysqlInit = mysql_init(NULL);
     if (!mysqlInit)
     {
-        std::cout << "Could not initialize Mysql connection to database " << m_connectionInfo.database.c_str();
+        LOG_ERROR("sql", "Could not initialize Mysql connection to database {}", m_connectionInfo.database);
         return false;
     }
 
@@ -86,11 +100,11 @@ bool MySQLConnection::Open(MySQLConnectionInfo connectInfo)
     {
         if (!m_reconnecting)
         {
-            std::cout << "MySQL client library: " <<  mysql_get_client_info() << std::endl;
-            std::cout << "MySQL server ver: " << mysql_get_server_info(m_Mysql) << std::endl;
+            LOG_INFO("sql", "MySQL client library: {}", mysql_get_client_info());
+            LOG_INFO("sql", "MySQL server ver: {}", mysql_get_server_info(m_Mysql));
         }
 
-        std::cout << "Connected to MySQL database at " << m_connectionInfo.host.c_str() << std::endl;
+        LOG_INFO("sql", "Connected to MySQL database at {}", m_connectionInfo.host);
         mysql_autocommit(m_Mysql, 1);
 
         // set connection properties to UTF8 to properly handle locales for different
@@ -99,7 +113,7 @@ bool MySQLConnection::Open(MySQLConnectionInfo connectInfo)
     }
     else
     {
-        std::cout << "Could not connect to MySQL database at " << m_connectionInfo.host.c_str() << ". " << mysql_error(mysqlInit) << std::endl;
+        LOG_ERROR("sql", "Could not connect to MySQL database at {}. {}", m_connectionInfo.host, mysql_error(mysqlInit));
         mysql_close(mysqlInit);
         return false;
     }
@@ -109,7 +123,11 @@ bool MySQLConnection::Open(MySQLConnectionInfo connectInfo)
 
 void MySQLConnection::Close()
 {
-    delete this;
+    if (m_Mysql)
+    {
+        mysql_close(m_Mysql);
+        m_Mysql = nullptr;
+    }
 }
 
 bool MySQLConnection::Execute(const char* sql)
@@ -118,14 +136,18 @@ bool MySQLConnection::Execute(const char* sql)
         return false;
 
     {
+        uint64 start = getNSTime();
         if (mysql_query(m_Mysql, sql))
         {
+            QueryErrors().Add();
             uint32 lErrno = mysql_errno(m_Mysql);
             if (_HandleMySQLErrno(lErrno))  // If it returns true, an error was handled successfully (i.e. reconnection)
                 return Execute(sql);       // Try again
 
             return false;
         }
+
+        QueryTimes().Record(getNSTime() - start);
     }
 
     return true;
@@ -153,8 +175,10 @@ bool MySQLConnection::_Query(const char *sql, MYSQL_RES **pResult, MYSQL_FIELD *
         return false;
 
     {
+        uint64 start = getNSTime();
         if (mysql_query(m_Mysql, sql))
         {
+            QueryErrors().Add();
             uint32 lErrno = mysql_errno(m_Mysql);
             if (_HandleMySQLErrno(lErrno))      // If it returns true, an error was handled successfully (i.e. reconnection)
                 return _Query(sql, pResult, pFields, pRowCount, pFieldCount);    // We try again
@@ -165,6 +189,7 @@ bool MySQLConnection::_Query(const char *sql, MYSQL_RES **pResult, MYSQL_FIELD *
         *pResult = mysql_store_result(m_Mysql);
         *pRowCount = mysql_affected_rows(m_Mysql);
         *pFieldCount = mysql_field_count(m_Mysql);
+        QueryTimes().Record(getNSTime() - start);
     }
 
     if (!*pResult )
@@ -194,7 +219,7 @@ bool MySQLConnection::_HandleMySQLErrno(uint32 errNo)
             mysql_close(GetHandle());
             if (this->Open(m_connectionInfo))                           // Don't remove 'this' pointer unless you want to skip loading all prepared statements....
             {
-                std::cout << "Connection to the MySQL server is active." << std::endl;
+                LOG_INFO("sql", "Connection to the MySQL server is active.");
                 m_reconnecting = false;
                 return true;
             }
@@ -213,17 +238,17 @@ bool MySQLConnection::_HandleMySQLErrno(uint32 errNo)
         // Outdated table or database structure - terminate core
         case ER_BAD_FIELD_ERROR:
         case ER_NO_SUCH_TABLE:
-            std::cout << "Your database structure is not up to date. Please make sure you've executed all queries in the sql/updates folders." << std::endl;
+            LOG_FATAL("sql", "Your database structure is not up to date. Please make sure you've executed all queries in the sql/updates folders.");
             std::this_thread::sleep_for(std::chrono::seconds(10));
             std::abort();
             return false;
         case ER_PARSE_ERROR:
-            std::cout << "Error while parsing SQL. Core fix required." << std::endl;
+            LOG_FATAL("sql", "Error while parsing SQL. Core fix required.");
             std::this_thread::sleep_for(std::chrono::seconds(10));
             std::abort();
             return false;
         default:
-            std::cout << "Unhandled MySQL errno " << errNo << " Unexpected behaviour possible." << std::endl;
+            LOG_ERROR("sql", "Unhandled MySQL errno {} Unexpected behaviour possible.", errNo);
             return false;
     }
 }
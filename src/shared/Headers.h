@@ -16,13 +16,15 @@
 #ifndef __SERVERHDR_H__
 #define __SERVERHDR_H__
 
+#include "Define.h"
+
 #pragma pack(push, 1)
 
 struct ServerHeader
 {
     uint16 Size;
     uint32 Command;
-} Setup;
+};
 
 #pragma pack(pop)
 
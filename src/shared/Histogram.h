@@ -0,0 +1,160 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "Define.h"
+
+#include <atomic>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+  * Log-linear histogram in the manner of HdrHistogram.
+  * Each power of two is split into SUB_BUCKETS linear buckets, so any recorded value is known
+  * to within 1/SUB_BUCKETS (~6%) from 1 up to 2^MAX_BITS; larger values land in the last bucket.
+  *
+  * Record() is for a single writing thread and costs a few plain loads and stores. Any
+  * other thread may read or Merge() from it at the same time: it then sees each bucket
+  * either before or after a concurrent record, never a torn value.
+*/
+class Histogram
+{
+    public:
+        static uint32 const SUB_BITS = 4;
+        static uint32 const SUB_BUCKETS = 1 << SUB_BITS;
+        static uint32 const MAX_BITS = 40;                  // 2^40 ns is about 18 minutes
+        static uint32 const BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_BUCKETS;
+
+        Histogram() { Reset(); }
+
+        /// Writer thread only
+        void Record(uint64 value)
+        {
+            Add(_buckets[BucketOf(value)], 1);
+            Add(_count, 1);
+            Add(_sum, value);
+            if (value > _max.load(std::memory_order_relaxed))
+                _max.store(value, std::memory_order_relaxed);
+        }
+
+        /// Adds the values recorded in other, this must not be recorded to at the same time
+        void Merge(Histogram const& other)
+        {
+            for (uint32 i = 0; i < BUCKETS; ++i)
+                Add(_buckets[i], other._buckets[i].load(std::memory_order_relaxed));
+
+            Add(_count, other._count.load(std::memory_order_relaxed));
+            Add(_sum, other._sum.load(std::memory_order_relaxed));
+            uint64 max = other._max.load(std::memory_order_relaxed);
+            if (max > _max.load(std::memory_order_relaxed))
+                _max.store(max, std::memory_order_relaxed);
+        }
+
+        void Reset()
+        {
+            for (uint32 i = 0; i < BUCKETS; ++i)
+                _buckets[i].store(0, std::memory_order_relaxed);
+
+            _count.store(0, std::memory_order_relaxed);
+            _sum.store(0, std::memory_order_relaxed);
+            _max.store(0, std::memory_order_relaxed);
+        }
+
+        uint64 GetCount() const { return _count.load(std::memory_order_relaxed); }
+        uint64 GetSum() const { return _sum.load(std::memory_order_relaxed); }
+        uint64 GetMax() const { return _max.load(std::memory_order_relaxed); }
+        uint64 GetMean() const { uint64 count = GetCount(); return count ? GetSum() / count : 0; }
+
+        /// Highest value of the bucket holding the given percentile (0-100), 0 when empty
+        uint64 GetPercentile(double percentile) const
+        {
+            uint64 count = 0;
+            for (uint32 i = 0; i < BUCKETS; ++i)
+                count += _buckets[i].load(std::memory_order_relaxed);
+
+            if (!count)
+                return 0;
+
+            uint64 rank = uint64(percentile / 100.0 * double(count) + 0.5);
+            if (rank < 1)
+                rank = 1;
+
+            uint64 seen = 0;
+            for (uint32 i = 0; i < BUCKETS; ++i)
+            {
+                seen += _buckets[i].load(std::memory_order_relaxed);
+                if (seen >= rank)
+                {
+                    // the bucket's upper bound, but never above what was actually recorded
+                    uint64 value = i + 1 < BUCKETS ? LowestOf(i + 1) - 1 : GetMax();
+                    uint64 max = GetMax();
+                    return value < max ? value : max;
+                }
+            }
+
+            return GetMax();
+        }
+
+        /// Buckets are exposed for exporters: [LowestOf(i), LowestOf(i + 1)) holds GetBucket(i) values
+        uint64 GetBucket(uint32 index) const { return _buckets[index].load(std::memory_order_relaxed); }
+
+        static uint32 BucketOf(uint64 value)
+        {
+            if (value < SUB_BUCKETS)
+                return uint32(value);
+
+#if defined(_MSC_VER)
+            unsigned long msb;
+            _BitScanReverse64(&msb, value);
+#else
+            uint32 msb = 63 - uint32(__builtin_clzll(value));
+#endif
+            if (msb >= MAX_BITS)
+                return BUCKETS - 1;
+
+            uint32 shift = uint32(msb) - SUB_BITS;
+            return (shift + 1) * SUB_BUCKETS + uint32((value >> shift) & (SUB_BUCKETS - 1));
+        }
+
+        static uint64 LowestOf(uint32 index)
+        {
+            if (index < SUB_BUCKETS)
+                return index;
+
+            uint32 shift = index / SUB_BUCKETS - 1;
+            return uint64(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+        }
+
+    private:
+        // single writer, so no read-modify-write instruction is needed
+        static void Add(std::atomic<uint64>& counter, uint64 value)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        std::atomic<uint64> _buckets[BUCKETS];
+        std::atomic<uint64> _count;
+        std::atomic<uint64> _sum;
+        std::atomic<uint64> _max;
+
+        Histogram(Histogram const& right) = delete;
+        Histogram& operator=(Histogram const& right) = delete;
+};
+
+#endif
@@ -16,6 +16,8 @@
 #ifndef LOCKEDQUEUE_H
 #define LOCKEDQUEUE_H
 
+#include <chrono>
+#include <condition_variable>
 #include <deque>
 #include <mutex>
 
@@ -25,6 +27,9 @@ class LockedQueue
     //! Lock access to the queue.
     std::mutex _lock;
 
+    //! Signalled when items are added or the queue is cancelled.
+    std::condition_variable _added;
+
     //! Storage backing the queue.
     StorageType _queue;
 
@@ -33,6 +38,8 @@ class LockedQueue
 
 public:
 
+    typedef StorageType storage_type;
+
     //! Create a LockedQueue.
     LockedQueue()
         : _canceled(false)
@@ -52,6 +59,8 @@ public:
         _queue.push_back(item);
 
         _lock.unlock();
+
+        _added.notify_one();
     }
 
     //! Adds items back to front of the queue
@@ -60,6 +69,7 @@ public:
     {
         std::lock_guard<std::mutex> lock(_lock);
         _queue.insert(_queue.begin(), begin, end);
+        _added.notify_one();
     }
 
     //! Gets the next result in the queue, if any.
@@ -76,6 +86,36 @@ public:
         return true;
     }
 
+    //! Waits up to timeout for an item, false when none came or the queue got cancelled.
+    template<class Rep, class Period>
+    bool wait_next(T& result, std::chrono::duration<Rep, Period> const& timeout)
+    {
+        std::unique_lock<std::mutex> lock(_lock);
+
+        if (!_added.wait_for(lock, timeout, [this]() { return _canceled || !_queue.empty(); }) || _canceled)
+            return false;
+
+        result = _queue.front();
+        _queue.pop_front();
+
+        return true;
+    }
+
+    //! Moves everything queued into result (cleared first) with a single lock; result's storage is reused by the queue. False when nothing was queued.
+    bool drain(StorageType& result)
+    {
+        result.clear();
+
+        std::lock_guard<std::mutex> lock(_lock);
+
+        if (_queue.empty())
+            return false;
+
+        std::swap(_queue, result);
+
+        return true;
+    }
+
     //! Peeks at the top of the queue. Check if the queue is empty before calling! Remember to unlock after use if autoUnlock == false.
     T& peek(bool autoUnlock = false)
     {
@@ -92,9 +132,13 @@ public:
     //! Cancels the queue.
     void cancel()
     {
-        std::lock_guard<std::mutex> lock(_lock);
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+
+            _canceled = true;
+        }
 
-        _canceled = true;
+        _added.notify_all();
     }
 
     //! Checks if the queue is cancelled.
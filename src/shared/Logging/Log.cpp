@@ -0,0 +1,272 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+
+namespace
+{
+    char const* const LevelNames[LOG_LEVEL_DISABLED] = { "TRACE", "DEBUG", "INFO ", "WARN ", "ERROR", "FATAL" };
+
+    template<class T>
+    T ReadArg(uint8 const* args, size_t& pos)
+    {
+        T value;
+        std::memcpy(&value, args + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+}
+
+uint32 const Log::FLUSH_INTERVAL;
+
+Log::Log() : _level(LOG_LEVEL_TRACE), _dropped(0), _reportedDropped(0), _thread(nullptr), _stopped(false), _flushRequested(false), _output(nullptr)
+{
+}
+
+Log::~Log()
+{
+    Stop();
+}
+
+void Log::Start(std::FILE* output)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    if (_thread)
+        return;
+
+    _output = output;
+    _stopped = false;
+    _thread = new std::thread(&Log::Run, this);
+}
+
+void Log::Stop()
+{
+    // taken out under the lock, so only one caller joins
+    std::thread* thread;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (!_thread)
+            return;
+
+        _stopped = true;
+        thread = _thread;
+        _thread = nullptr;
+    }
+
+    _wakeup.notify_one();
+    thread->join();
+    delete thread;
+}
+
+uint64 Log::Now()
+{
+    return uint64(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+Log::ThreadQueue& Log::GetThreadQueue()
+{
+    static thread_local ThreadQueue* queue = nullptr;
+    if (!queue)
+    {
+        std::lock_guard<std::mutex> guard(_queuesLock);
+        _queues.push_back(std::unique_ptr<ThreadQueue>(new ThreadQueue(uint32(_queues.size() + 1))));
+        queue = _queues.back().get();
+    }
+
+    return *queue;
+}
+
+void Log::Enqueue(LogRecord& record)
+{
+    ThreadQueue& queue = GetThreadQueue();
+    record.thread = queue.id;
+
+    if (!queue.queue.add(record))
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Log::WaitForRoom(size_t records)
+{
+    ThreadQueue& queue = GetThreadQueue();
+    records = std::min(records, queue.queue.capacity());
+
+    while (queue.queue.available() < records)
+    {
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            if (!_thread || _stopped)
+                return;
+
+            _flushRequested = true;
+        }
+
+        _wakeup.notify_one();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void Log::Run()
+{
+    std::string text;
+    while (true)
+    {
+        bool stopped;
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+            _wakeup.wait_for(guard, std::chrono::milliseconds(FLUSH_INTERVAL), [this]() { return _stopped || _flushRequested; });
+            _flushRequested = false;
+            stopped = _stopped;
+        }
+
+        // once stopped, keep going until the rings are empty
+        while (Collect())
+        {
+            text.clear();
+            for (LogRecord const& record : _batch)
+                Format(record, text);
+
+            WriteOut(text);
+        }
+
+        uint64 dropped = _dropped.load(std::memory_order_relaxed);
+        if (dropped != _reportedDropped)
+        {
+            text = "Log: " + std::to_string(dropped - _reportedDropped) + " messages dropped, logging faster than they could be written\n";
+            WriteOut(text);
+            _reportedDropped = dropped;
+        }
+
+        if (stopped)
+            break;
+    }
+}
+
+size_t Log::Collect()
+{
+    _batch.clear();
+
+    {
+        std::lock_guard<std::mutex> guard(_queuesLock);
+        for (std::unique_ptr<ThreadQueue> const& queue : _queues)
+        {
+            queue->queue.drain([this](LogRecord const& record) -> bool
+            {
+                _batch.push_back(record);
+                return true;
+            });
+        }
+    }
+
+    // each ring is in order already, this only interleaves the threads
+    std::stable_sort(_batch.begin(), _batch.end(), [](LogRecord const& left, LogRecord const& right)
+    {
+        return left.time < right.time;
+    });
+
+    return _batch.size();
+}
+
+void Log::Format(LogRecord const& record, std::string& line) const
+{
+    time_t seconds = time_t(record.time / 1000000000);
+    std::tm local;
+#if defined(_WIN32)
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+
+    char prefix[64];
+    size_t length = std::strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &local);
+    std::snprintf(prefix + length, sizeof(prefix) - length, ".%03u ", uint32(record.time / 1000000 % 1000));
+    line += prefix;
+    line += LevelNames[record.level < LOG_LEVEL_DISABLED ? record.level : LOG_LEVEL_FATAL];
+    line += " [";
+    line += record.category;
+    line += "] ";
+
+    size_t pos = 0;
+    char buffer[32];
+    for (char const* format = record.format; *format; ++format)
+    {
+        if (format[0] != '{' || format[1] != '}')
+        {
+            line += *format;
+            continue;
+        }
+
+        ++format;
+        if (pos >= record.argSize)
+        {
+            line += "{}";
+            continue;
+        }
+
+        switch (record.args[pos++])
+        {
+            case LogRecord::ARG_INT:
+                std::snprintf(buffer, sizeof(buffer), "%lld", (long long)ReadArg<int64>(record.args, pos));
+                line += buffer;
+                break;
+            case LogRecord::ARG_UINT:
+                std::snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)ReadArg<uint64>(record.args, pos));
+                line += buffer;
+                break;
+            case LogRecord::ARG_DOUBLE:
+                std::snprintf(buffer, sizeof(buffer), "%g", ReadArg<double>(record.args, pos));
+                line += buffer;
+                break;
+            case LogRecord::ARG_BOOL:
+                line += ReadArg<bool>(record.args, pos) ? "true" : "false";
+                break;
+            case LogRecord::ARG_CHAR:
+                line += ReadArg<char>(record.args, pos);
+                break;
+            case LogRecord::ARG_POINTER:
+                std::snprintf(buffer, sizeof(buffer), "%p", ReadArg<void const*>(record.args, pos));
+                line += buffer;
+                break;
+            case LogRecord::ARG_STRING:
+            {
+                uint16 stringLength = ReadArg<uint16>(record.args, pos);
+                line.append(reinterpret_cast<char const*>(record.args + pos), stringLength);
+                pos += stringLength;
+                break;
+            }
+            default:
+                pos = record.argSize;
+                break;
+        }
+    }
+
+    if (record.truncated)
+        line += " (truncated)";
+
+    line += '\n';
+}
+
+void Log::WriteOut(std::string const& text)
+{
+    if (!_output || text.empty())
+        return;
+
+    std::fwrite(text.data(), 1, text.size(), _output);
+    std::fflush(_output);
+}
@@ -0,0 +1,251 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SHARED_LOG_H
+#define SHARED_LOG_H
+
+#include "Define.h"
+#include "SPSCQueue.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+enum LogLevel : uint8
+{
+    LOG_LEVEL_TRACE,
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_FATAL,
+    LOG_LEVEL_DISABLED
+};
+
+/// Levels below are compiled out, their arguments are not even evaluated
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+/**
+  * One log call, as it travels from the logging thread to the formatter.
+  * The arguments are kept in binary, each a type tag followed by the value;
+  * strings are copied and cut short when they do not fit.
+*/
+struct LogRecord
+{
+    static size_t const ARG_SIZE = 216;
+
+    enum ArgType : uint8
+    {
+        ARG_INT,
+        ARG_UINT,
+        ARG_DOUBLE,
+        ARG_BOOL,
+        ARG_CHAR,
+        ARG_STRING,
+        ARG_POINTER
+    };
+
+    uint64 time;                                            // nanoseconds since the epoch
+    char const* category;                                   // string literals, never copied
+    char const* format;
+    LogLevel level;
+    bool truncated;
+    uint16 argSize;
+    uint32 thread;
+    uint8 args[ARG_SIZE];
+
+    void Put(int64 value) { PutTagged(ARG_INT, &value, sizeof(value)); }
+    void Put(uint64 value) { PutTagged(ARG_UINT, &value, sizeof(value)); }
+    void Put(double value) { PutTagged(ARG_DOUBLE, &value, sizeof(value)); }
+    void Put(bool value) { PutTagged(ARG_BOOL, &value, sizeof(value)); }
+    void Put(char value) { PutTagged(ARG_CHAR, &value, sizeof(value)); }
+    void Put(void const* value) { PutTagged(ARG_POINTER, &value, sizeof(value)); }
+    void Put(char const* value) { PutString(value ? value : "(null)", value ? std::strlen(value) : 6); }
+    void Put(std::string const& value) { PutString(value.c_str(), value.size()); }
+
+    template<class T>
+    typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type Put(T value) { Put(int64(value)); }
+    template<class T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type Put(T value) { Put(uint64(value)); }
+    template<class T>
+    typename std::enable_if<std::is_enum<T>::value>::type Put(T value) { Put(int64(value)); }
+    void Put(float value) { Put(double(value)); }
+    void Put(char* value) { Put(static_cast<char const*>(value)); }
+
+    void PutArgs() { }
+
+    template<class T, class... Rest>
+    void PutArgs(T const& value, Rest const&... rest)
+    {
+        Put(value);
+        PutArgs(rest...);
+    }
+
+private:
+    void PutTagged(ArgType type, void const* value, size_t size)
+    {
+        if (argSize + 1 + size > ARG_SIZE)
+        {
+            truncated = true;
+            return;
+        }
+
+        args[argSize++] = type;
+        std::memcpy(&args[argSize], value, size);
+        argSize += uint16(size);
+    }
+
+    void PutString(char const* value, size_t length)
+    {
+        size_t header = 1 + sizeof(uint16);
+        if (argSize + header >= ARG_SIZE)
+        {
+            truncated = true;
+            return;
+        }
+
+        if (length > ARG_SIZE - argSize - header)
+        {
+            length = ARG_SIZE - argSize - header;
+            truncated = true;
+        }
+
+        uint16 stored = uint16(length);
+        args[argSize++] = ARG_STRING;
+        std::memcpy(&args[argSize], &stored, sizeof(stored));
+        argSize += sizeof(stored);
+        std::memcpy(&args[argSize], value, length);
+        argSize += stored;
+    }
+};
+
+/**
+  * Asynchronous logger.
+  * A log call only encodes its arguments into a record and puts it on the calling thread's
+  * own lock-free ring; a background thread merges the rings in time order, replaces each {}
+  * of the format with the next argument and writes the lines out. When a thread's ring is
+  * full the record is dropped and counted, a log call never waits. A background thread that
+  * must not lose any of a group of lines asks for room first with WaitForRoom().
+  *
+  * Format strings and categories must be string literals, they are kept by pointer.
+*/
+class Log
+{
+    public:
+        static size_t const THREAD_QUEUE_SIZE = 1024;       // records per logging thread
+        static uint32 const FLUSH_INTERVAL = 10;            // milliseconds the formatter sleeps when idle
+
+        static Log* instance()
+        {
+            static Log instance;
+            return &instance;
+        }
+
+        ~Log();
+
+        /// Starts the formatter writing to output (nullptr formats and discards), records logged before are written then
+        void Start(std::FILE* output = stdout);
+        /// Writes everything logged so far and stops the formatter
+        void Stop();
+
+        /// Runtime threshold on top of LOG_MIN_LEVEL
+        void SetLevel(LogLevel level) { _level.store(level, std::memory_order_relaxed); }
+        bool ShouldLog(LogLevel level) const { return level >= _level.load(std::memory_order_relaxed); }
+
+        /// Blocks until the calling thread's ring takes records more (at most all of it); returns at once while the formatter is stopped
+        void WaitForRoom(size_t records);
+
+        template<class... Args>
+        void Write(LogLevel level, char const* category, char const* format, Args const&... args)
+        {
+            LogRecord record;
+            record.time = Now();
+            record.category = category;
+            record.format = format;
+            record.level = level;
+            record.truncated = false;
+            record.argSize = 0;
+            record.PutArgs(args...);
+            Enqueue(record);
+        }
+
+        uint64 GetDroppedCount() const { return _dropped.load(std::memory_order_relaxed); }
+
+    private:
+        Log();
+
+        struct ThreadQueue
+        {
+            ThreadQueue(uint32 id_) : id(id_), queue(THREAD_QUEUE_SIZE) { }
+
+            uint32 id;
+            SPSCQueue<LogRecord> queue;
+        };
+
+        static uint64 Now();
+        ThreadQueue& GetThreadQueue();
+        void Enqueue(LogRecord& record);
+
+        void Run();
+        size_t Collect();
+        void Format(LogRecord const& record, std::string& line) const;
+        void WriteOut(std::string const& text);
+
+        std::atomic<uint8> _level;
+        std::atomic<uint64> _dropped;
+        uint64 _reportedDropped;                            // formatter only
+
+        std::mutex _queuesLock;
+        std::vector<std::unique_ptr<ThreadQueue>> _queues;  // outlive their threads, what is left is still written
+
+        std::mutex _lock;
+        std::condition_variable _wakeup;
+        std::thread* _thread;
+        bool _stopped;
+        bool _flushRequested;                               // by WaitForRoom, the formatter collects before its interval is up
+        std::FILE* _output;
+
+        std::vector<LogRecord> _batch;                      // formatter only
+
+        Log(Log const& right) = delete;
+        Log& operator=(Log const& right) = delete;
+};
+
+#define sLog Log::instance()
+
+#define LOG_MESSAGE(level, category, ...) \
+    do { \
+        if (level >= LOG_MIN_LEVEL && sLog->ShouldLog(level)) \
+            sLog->Write(level, category, __VA_ARGS__); \
+    } while (0)
+
+#define LOG_TRACE(category, ...) LOG_MESSAGE(LOG_LEVEL_TRACE, category, __VA_ARGS__)
+#define LOG_DEBUG(category, ...) LOG_MESSAGE(LOG_LEVEL_DEBUG, category, __VA_ARGS__)
+#define LOG_INFO(category, ...) LOG_MESSAGE(LOG_LEVEL_INFO, category, __VA_ARGS__)
+#define LOG_WARN(category, ...) LOG_MESSAGE(LOG_LEVEL_WARN, category, __VA_ARGS__)
+#define LOG_ERROR(category, ...) LOG_MESSAGE(LOG_LEVEL_ERROR, category, __VA_ARGS__)
+#define LOG_FATAL(category, ...) LOG_MESSAGE(LOG_LEVEL_FATAL, category, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,210 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Metrics.h"
+
+#include <cstdio>
+
+MetricCounter::MetricCounter()
+{
+    for (uint32 i = 0; i < CELLS; ++i)
+        _cells[i].value.store(0, std::memory_order_relaxed);
+}
+
+uint64 MetricCounter::Get() const
+{
+    uint64 total = 0;
+    for (uint32 i = 0; i < CELLS; ++i)
+        total += _cells[i].value.load(std::memory_order_relaxed);
+
+    return total;
+}
+
+Histogram& MetricHistogram::AddShard(std::vector<Histogram*>& shards)
+{
+    if (shards.size() <= _id)
+        shards.resize(_id + 1, nullptr);
+
+    std::unique_ptr<Histogram> shard(new Histogram());
+    shards[_id] = shard.get();
+
+    std::lock_guard<std::mutex> guard(_lock);
+    _shards.push_back(std::move(shard));
+    return *shards[_id];
+}
+
+void MetricHistogram::Merge(Histogram& result) const
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    for (std::unique_ptr<Histogram> const& shard : _shards)
+        result.Merge(*shard);
+}
+
+void MetricsWriter::Header(char const* name, char const* help, char const* type)
+{
+    _out += "# HELP ";
+    _out += name;
+    _out += ' ';
+    _out += help;
+    _out += "\n# TYPE ";
+    _out += name;
+    _out += ' ';
+    _out += type;
+    _out += '\n';
+}
+
+void MetricsWriter::Sample(char const* name, char const* labels, double value)
+{
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), " %.9g\n", value);
+
+    _out += name;
+    if (labels && *labels)
+    {
+        _out += '{';
+        _out += labels;
+        _out += '}';
+    }
+    _out += buffer;
+}
+
+void MetricsWriter::Sample(char const* name, char const* labels, uint64 value)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), " %llu\n", (unsigned long long)value);
+
+    _out += name;
+    if (labels && *labels)
+    {
+        _out += '{';
+        _out += labels;
+        _out += '}';
+    }
+    _out += buffer;
+}
+
+void MetricsWriter::Summary(char const* name, char const* labels, Histogram const& histogram, double scale)
+{
+    static double const Quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+    std::string prefix = labels && *labels ? std::string(labels) + "," : std::string();
+    for (double quantile : Quantiles)
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "quantile=\"%g\"", quantile);
+        Sample(name, (prefix + buffer).c_str(), double(histogram.GetPercentile(quantile * 100.0)) * scale);
+    }
+
+    std::string sum = std::string(name) + "_sum";
+    std::string count = std::string(name) + "_count";
+    Sample(sum.c_str(), labels, double(histogram.GetSum()) * scale);
+    Sample(count.c_str(), labels, histogram.GetCount());
+}
+
+Metrics::Entry& Metrics::GetEntry(char const* name, char const* help, MetricType type)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    for (std::unique_ptr<Entry> const& entry : _entries)
+        if (entry->name == name && entry->type == type)
+            return *entry;
+
+    std::unique_ptr<Entry> entry(new Entry());
+    entry->name = name;
+    entry->help = help;
+    entry->type = type;
+    switch (type)
+    {
+        case METRIC_COUNTER:
+            entry->counter.reset(new MetricCounter());
+            break;
+        case METRIC_GAUGE:
+            entry->gauge.reset(new MetricGauge());
+            break;
+        case METRIC_HISTOGRAM:
+            entry->histogram.reset(new MetricHistogram(uint32(_entries.size())));
+            break;
+    }
+
+    _entries.push_back(std::move(entry));
+    return *_entries.back();
+}
+
+MetricCounter& Metrics::GetCounter(char const* name, char const* help)
+{
+    return *GetEntry(name, help, METRIC_COUNTER).counter;
+}
+
+MetricGauge& Metrics::GetGauge(char const* name, char const* help)
+{
+    return *GetEntry(name, help, METRIC_GAUGE).gauge;
+}
+
+MetricHistogram& Metrics::GetHistogram(char const* name, char const* help)
+{
+    return *GetEntry(name, help, METRIC_HISTOGRAM).histogram;
+}
+
+void Metrics::AddCollector(Collector&& collector)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    _collectors.push_back(std::move(collector));
+}
+
+std::string Metrics::Render() const
+{
+    // entries are never removed, so only the lists are copied under the lock and a thread
+    // registering its first metric does not wait for the rendering
+    std::vector<Entry const*> entries;
+    std::vector<Collector> collectors;
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        for (std::unique_ptr<Entry> const& entry : _entries)
+            entries.push_back(entry.get());
+
+        collectors = _collectors;
+    }
+
+    std::string out;
+    MetricsWriter writer(out);
+
+    for (Entry const* entry : entries)
+    {
+        switch (entry->type)
+        {
+            case METRIC_COUNTER:
+                writer.Header(entry->name.c_str(), entry->help.c_str(), "counter");
+                writer.Sample(entry->name.c_str(), nullptr, entry->counter->Get());
+                break;
+            case METRIC_GAUGE:
+                writer.Header(entry->name.c_str(), entry->help.c_str(), "gauge");
+                writer.Sample(entry->name.c_str(), nullptr, double(entry->gauge->Get()));
+                break;
+            case METRIC_HISTOGRAM:
+            {
+                std::unique_ptr<Histogram> merged(new Histogram());
+                entry->histogram->Merge(*merged);
+                writer.Header(entry->name.c_str(), entry->help.c_str(), "summary");
+                writer.Summary(entry->name.c_str(), nullptr, *merged, 1e-9);
+                break;
+            }
+        }
+    }
+
+    for (Collector const& collector : collectors)
+        collector(writer);
+
+    return out;
+}
@@ -0,0 +1,179 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SHARED_METRICS_H
+#define SHARED_METRICS_H
+
+#include "Define.h"
+#include "Histogram.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// Monotonic count; Add() from any thread, spread over cache lines so threads do not contend
+class MetricCounter
+{
+    public:
+        static uint32 const CELLS = 16;
+
+        MetricCounter();
+
+        void Add(uint64 value = 1) { _cells[ThreadCell()].value.fetch_add(value, std::memory_order_relaxed); }
+        uint64 Get() const;
+
+    private:
+        static uint32 ThreadCell()
+        {
+            static std::atomic<uint32> next(0);
+            static thread_local uint32 cell = next.fetch_add(1, std::memory_order_relaxed) % CELLS;
+            return cell;
+        }
+
+        struct Cell
+        {
+            std::atomic<uint64> value;
+            char pad[64 - sizeof(std::atomic<uint64>)];
+        };
+
+        Cell _cells[CELLS];
+};
+
+/// Current value, usually Set() by the one thread owning what it measures
+class MetricGauge
+{
+    public:
+        MetricGauge() : _value(0) { }
+
+        void Set(int64 value) { _value.store(value, std::memory_order_relaxed); }
+        void Add(int64 value) { _value.fetch_add(value, std::memory_order_relaxed); }
+        int64 Get() const { return _value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<int64> _value;
+};
+
+/// Distribution of values (nanoseconds for times); every recording thread gets a Histogram of its own
+class MetricHistogram
+{
+    public:
+        explicit MetricHistogram(uint32 id) : _id(id) { }
+
+        void Record(uint64 value) { GetShard().Record(value); }
+        /// Adds all shards into result
+        void Merge(Histogram& result) const;
+
+    private:
+        Histogram& GetShard()
+        {
+            // indexed by histogram id, one list per thread for all histograms
+            static thread_local std::vector<Histogram*> shards;
+            if (_id < shards.size() && shards[_id])
+                return *shards[_id];
+
+            return AddShard(shards);
+        }
+
+        Histogram& AddShard(std::vector<Histogram*>& shards);
+
+        uint32 _id;
+        mutable std::mutex _lock;
+        std::vector<std::unique_ptr<Histogram>> _shards;    // outlive their threads
+};
+
+/// Writes samples in the Prometheus text exposition format
+class MetricsWriter
+{
+    public:
+        explicit MetricsWriter(std::string& out) : _out(out) { }
+
+        /// Starts a metric family, all of its samples must follow before the next one
+        void Header(char const* name, char const* help, char const* type);
+        /// labels is the inside of {}, e.g. opcode="CMSG_PING", or nullptr
+        void Sample(char const* name, char const* labels, double value);
+        void Sample(char const* name, char const* labels, uint64 value);
+        /// Quantiles, sum and count of histogram; scale converts recorded values to the exported unit
+        void Summary(char const* name, char const* labels, Histogram const& histogram, double scale);
+
+    private:
+        std::string& _out;
+};
+
+/**
+  * Registry of the server's metrics.
+  * Metrics are created on first use and live as long as the process, so callers keep a
+  * reference, typically in a function local static:
+  *     static MetricCounter& accepted = sMetrics->GetCounter("ships_connections_accepted_total", "Accepted connections");
+  * Collectors are called at render time for numbers kept elsewhere (OpcodeStats, TickProfiler).
+  * Rendering only reads atomics and merges shards, it never waits for the threads recording.
+*/
+class Metrics
+{
+    public:
+        typedef std::function<void(MetricsWriter&)> Collector;
+
+        static Metrics* instance()
+        {
+            static Metrics instance;
+            return &instance;
+        }
+
+        MetricCounter& GetCounter(char const* name, char const* help);
+        MetricGauge& GetGauge(char const* name, char const* help);
+        /// Exported as a summary in seconds, values are recorded in nanoseconds
+        MetricHistogram& GetHistogram(char const* name, char const* help);
+
+        void AddCollector(Collector&& collector);
+
+        /// All metrics in the Prometheus text format
+        std::string Render() const;
+
+    private:
+        Metrics() { }
+
+        enum MetricType
+        {
+            METRIC_COUNTER,
+            METRIC_GAUGE,
+            METRIC_HISTOGRAM
+        };
+
+        struct Entry
+        {
+            std::string name;
+            std::string help;
+            MetricType type;
+            std::unique_ptr<MetricCounter> counter;
+            std::unique_ptr<MetricGauge> gauge;
+            std::unique_ptr<MetricHistogram> histogram;
+        };
+
+        Entry& GetEntry(char const* name, char const* help, MetricType type);
+
+        mutable std::mutex _lock;
+        std::vector<std::unique_ptr<Entry>> _entries;
+        std::vector<Collector> _collectors;
+
+        Metrics(Metrics const& right) = delete;
+        Metrics& operator=(Metrics const& right) = delete;
+};
+
+#define sMetrics Metrics::instance()
+
+#endif
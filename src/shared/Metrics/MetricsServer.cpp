@@ -0,0 +1,115 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "MetricsServer.h"
+#include "Metrics.h"
+#include "Log.h"
+
+#include <memory>
+
+namespace
+{
+    size_t const MAX_REQUEST_SIZE = 4096;
+
+    class MetricsConnection : public std::enable_shared_from_this<MetricsConnection>
+    {
+    public:
+        explicit MetricsConnection(tcp::socket&& socket) : _socket(std::move(socket)), _request(MAX_REQUEST_SIZE) { }
+
+        void Start()
+        {
+            std::shared_ptr<MetricsConnection> self = shared_from_this();
+            boost::asio::async_read_until(_socket, _request, "\r\n\r\n",
+                [self](boost::system::error_code error, size_t /*length*/)
+            {
+                // a request over MAX_REQUEST_SIZE fails here too
+                if (error)
+                    return;
+
+                self->Respond();
+            });
+        }
+
+    private:
+        void Respond()
+        {
+            std::istream request(&_request);
+            std::string method, target;
+            request >> method >> target;
+
+            std::string body;
+            char const* status;
+            if (method != "GET")
+                status = "405 Method Not Allowed";
+            else if (target != "/metrics")
+                status = "404 Not Found";
+            else
+            {
+                status = "200 OK";
+                body = sMetrics->Render();
+            }
+
+            _response = "HTTP/1.1 ";
+            _response += status;
+            _response += "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: ";
+            _response += std::to_string(body.size());
+            _response += "\r\nConnection: close\r\n\r\n";
+            _response += body;
+
+            std::shared_ptr<MetricsConnection> self = shared_from_this();
+            boost::asio::async_write(_socket, boost::asio::buffer(_response),
+                [self](boost::system::error_code /*error*/, size_t /*length*/)
+            {
+                boost::system::error_code ignored;
+                self->_socket.shutdown(tcp::socket::shutdown_both, ignored);
+                self->_socket.close(ignored);
+            });
+        }
+
+        tcp::socket _socket;
+        boost::asio::streambuf _request;
+        std::string _response;
+    };
+}
+
+MetricsServer::MetricsServer(boost::asio::io_service& ioService, std::string const& bindIp, uint16 port) :
+    _acceptor(ioService, tcp::endpoint(boost::asio::ip::address::from_string(bindIp), port)),
+    _socket(ioService), _closed(false)
+{
+}
+
+void MetricsServer::AsyncAccept()
+{
+    _acceptor.async_accept(_socket, [this](boost::system::error_code error)
+    {
+        if (!error)
+            std::make_shared<MetricsConnection>(std::move(_socket))->Start();
+        else if (error != boost::asio::error::operation_aborted)
+            LOG_ERROR("metrics", "Failed to accept metrics connection: {}", error.message());
+
+        if (!_closed)
+            AsyncAccept();
+    });
+}
+
+void MetricsServer::Close()
+{
+    if (_closed.exchange(true))
+        return;
+
+    boost::system::error_code err;
+    _acceptor.close(err);
+}
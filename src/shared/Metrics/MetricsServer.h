@@ -0,0 +1,49 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SHARED_METRICSSERVER_H
+#define SHARED_METRICSSERVER_H
+
+#include "Define.h"
+#include <boost/asio.hpp>
+#include <atomic>
+#include <string>
+
+using boost::asio::ip::tcp;
+
+/**
+  * Serves sMetrics->Render() as GET /metrics over plain HTTP, for a Prometheus scraper.
+  * Runs on the network io_service like the game acceptor: a scrape only reads metrics,
+  * the world thread never waits for it. One request per connection.
+*/
+class MetricsServer
+{
+public:
+    //! Throws boost::system::system_error when the address can not be bound
+    MetricsServer(boost::asio::io_service& ioService, std::string const& bindIp, uint16 port);
+
+    void Start() { AsyncAccept(); }
+    void Close();
+
+private:
+    void AsyncAccept();
+
+    tcp::acceptor _acceptor;
+    tcp::socket _socket;
+    std::atomic<bool> _closed;
+};
+
+#endif
@@ -17,6 +17,7 @@
 #define __ASYNCACCEPT_H_
 
 #include "Define.h"
+#include "Log.h"
 #include <boost/asio.hpp>
 
 using boost::asio::ip::tcp;
@@ -45,7 +46,7 @@ public:
                 }
                 catch (boost::system::system_error const& err)
                 {
-                    std::cout << "Failed to initialize client's socket " << err.what() << std::endl;
+                    LOG_ERROR("network", "Failed to initialize client's socket {}", err.what());
                 }
             }
 
@@ -19,6 +19,8 @@
 #include "Define.h"
 #include "Socket.h"
 #include "Timer.h"
+#include "Log.h"
+#include "Metrics.h"
 
 #include <atomic>
 #include <chrono>
@@ -77,8 +79,23 @@ public:
     }
 
 protected:
-    void SocketAdded(std::shared_ptr<Socket> /*sock*/) { }
-    void SocketRemoved(std::shared_ptr<Socket> /*sock*/) { }
+    void SocketAdded(std::shared_ptr<Socket> /*sock*/)
+    {
+        static MetricCounter& accepted = sMetrics->GetCounter("ships_connections_accepted_total", "Connections accepted");
+        accepted.Add();
+        OpenConnections().Add(1);
+    }
+
+    void SocketRemoved(std::shared_ptr<Socket> /*sock*/)
+    {
+        OpenConnections().Add(-1);
+    }
+
+    static MetricGauge& OpenConnections()
+    {
+        static MetricGauge& open = sMetrics->GetGauge("ships_connections", "Connections open on all network threads");
+        return open;
+    }
 
     void AddNewSockets()
     {
@@ -104,7 +121,7 @@ protected:
 
     void Run()
     {
-        std::cout << "Network Thread Starting" << std::endl;
+        LOG_DEBUG("network", "Network Thread Starting");
 
         SocketSet::iterator i;
 
@@ -138,7 +155,7 @@ protected:
             sleepTime = diff > 10 ? 0 : 10 - diff;
         }
 
-        std::cout << "Network Thread exits" << std::endl;
+        LOG_DEBUG("network", "Network Thread exits");
         _newSockets.clear();
         _Sockets.clear();
     }
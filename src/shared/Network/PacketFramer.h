@@ -0,0 +1,107 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __PACKETFRAMER_H__
+#define __PACKETFRAMER_H__
+
+#include <algorithm>
+#include <cstring>
+
+#include "Define.h"
+#include "Opcodes.h"
+#include "MessageBuffer.h"
+
+struct ClientHeader
+{
+    uint16 Command;
+    uint16 Size;
+
+    static bool IsValidSize(uint32 size) { return size < 10240; }
+    static bool IsValidOpcode(uint32 opcode) { return opcode < NUM_MSG_TYPES; }
+};
+
+/**
+  * Cuts the received byte stream into client packets, header and payload.
+  * A header or payload split over several reads is kept until the rest arrives,
+  * several packets coalesced into one read are handed out one by one.
+  *
+  * The sink is called with
+  *     bool ReadHeaderHandler(ClientHeader const& header)  - false rejects the packet
+  *     bool ReadDataHandler(ClientHeader const& header, MessageBuffer& payload) - may move the payload away
+  * and Process() returns false as soon as one of them does.
+*/
+class PacketFramer
+{
+    public:
+        PacketFramer() : _headerBuffer(sizeof(ClientHeader)), _packetBuffer(0)
+        {
+            std::memset(&_header, 0, sizeof(_header));
+        }
+
+        template<class Sink>
+        bool Process(MessageBuffer& buffer, Sink& sink)
+        {
+            while (buffer.GetActiveSize() > 0)
+            {
+                if (_headerBuffer.GetRemainingSpace() > 0)
+                {
+                    // need to receive the header
+                    std::size_t readHeaderSize = std::min(buffer.GetActiveSize(), _headerBuffer.GetRemainingSpace());
+                    _headerBuffer.Write(buffer.GetReadPointer(), readHeaderSize);
+                    buffer.ReadCompleted(readHeaderSize);
+
+                    if (_headerBuffer.GetRemainingSpace() > 0)
+                        break;
+
+                    // We just received nice new header
+                    std::memcpy(&_header, _headerBuffer.GetReadPointer(), sizeof(ClientHeader));
+                    if (!sink.ReadHeaderHandler(_header))
+                        return false;
+
+                    _packetBuffer.Reset();
+                    _packetBuffer.Resize(_header.Size);
+                }
+
+                // We have full read header, now check the data payload
+                if (_packetBuffer.GetRemainingSpace() > 0)
+                {
+                    // need more data in the payload
+                    std::size_t readDataSize = std::min(buffer.GetActiveSize(), _packetBuffer.GetRemainingSpace());
+                    _packetBuffer.Write(buffer.GetReadPointer(), readDataSize);
+                    buffer.ReadCompleted(readDataSize);
+
+                    if (_packetBuffer.GetRemainingSpace() > 0)
+                    {
+                        // Couldn't receive the whole data this time.
+                        break;
+                    }
+                }
+
+                // just received fresh new payload
+                _headerBuffer.Reset();
+                if (!sink.ReadDataHandler(_header, _packetBuffer))
+                    return false;
+            }
+
+            return true;
+        }
+
+    private:
+        MessageBuffer _headerBuffer;
+        MessageBuffer _packetBuffer;
+        ClientHeader _header;
+};
+
+#endif // __PACKETFRAMER_H__
@@ -17,6 +17,11 @@
 #include "Packet.h"
 #include "Headers.h"
 #include "Session.h"
+#include "OpcodeStats.h"
+#include "Log.h"
+#include "Metrics.h"
+
+#include <cassert>
 
 #include <boost/asio/write.hpp>
 #include <boost/asio/read.hpp>
@@ -24,13 +29,23 @@
 #include "MessageBuffer.h"
 #include "Packet.h"
 
-uint32 const SizeOfClientHeader[2] = { 4, 4 };
 uint32 const SizeOfServerHeader = sizeof(uint16) + sizeof(uint32);
 
-Socket::Socket(boost::asio::ip::tcp::socket&& socket) : _session(nullptr), _authed(false), _socket(std::move(socket)), _readBuffer(), _headerBuffer(), _closed(false), _closing(false), _isWritingAsync(false)
+static MetricCounter& SentBytes()
+{
+    static MetricCounter& sent = sMetrics->GetCounter("ships_network_sent_bytes_total", "Bytes written to client sockets");
+    return sent;
+}
+
+static MetricCounter& RejectedPackets()
+{
+    static MetricCounter& rejected = sMetrics->GetCounter("ships_packets_rejected_total", "Packets refused by header checks, the connection is closed");
+    return rejected;
+}
+
+Socket::Socket(boost::asio::ip::tcp::socket&& socket) : _session(nullptr), _authed(false), _registrationAnswered(false), _socket(std::move(socket)), _readBuffer(), _closed(false), _closing(false), _isWritingAsync(false)
 {
     _readBuffer.Resize(READ_BLOCK_SIZE);
-    _headerBuffer.Resize(SizeOfClientHeader[0]);
 
     _socket.remote_endpoint().address(_remoteAddress);
     _socket.remote_endpoint().port(_remotePort);
@@ -48,6 +63,13 @@ bool Socket::Update()
     if (!IsOpen())
         return false;
 
+    std::unique_lock<std::mutex> guard(_writeLock);
+    if (_isWritingAsync || _writeQueue.empty())
+        return true;
+
+    while (HandleQueue(guard))
+        ;
+
     return true;
 }
 
@@ -85,18 +107,28 @@ void Socket::Start()
 
 void Socket::CloseSocket()
 {
+    // even when closed already: the session calls this before it is deleted, nothing may reach it afterwards
+    {
+        std::unique_lock<std::mutex> sessionGuard(_sessionLock);
+        _session = nullptr;
+
+        if (_inplaceThread == std::this_thread::get_id())
+        {
+            // an in-place handler reports a bad packet through its read error, ReadHandler then closes the socket
+            LOG_ERROR("network", "Socket::CloseSocket: client {} kicked from inside an in-place handler, the packet should fail to read instead", GetRemoteIpAddress().to_string());
+            assert(false && "kick inside an in-place handler");
+        }
+        else
+            _inplaceDone.wait(sessionGuard, [this]() { return _inplaceThread == std::thread::id(); });
+    }
+
     if (_closed.exchange(true))
         return;
 
     boost::system::error_code shutdownError;
     _socket.shutdown(boost::asio::socket_base::shutdown_send, shutdownError);
     if (shutdownError)
-        std::cout << "Socket::CloseSocket: " << GetRemoteIpAddress().to_string().c_str() << " errored when shutting down socket: " << shutdownError.value() << " (" << shutdownError.message().c_str() << ")";
-
-    {
-        std::lock_guard<std::mutex> sessionGuard(_sessionLock);
-        _session = nullptr;
-    }
+        LOG_DEBUG("network", "Socket::CloseSocket: {} errored when shutting down socket: {} ({})", GetRemoteIpAddress().to_string(), shutdownError.value(), shutdownError.message());
 }
 
 void Socket::ReadHandlerInternal(boost::system::error_code error, size_t transferredBytes)
@@ -107,6 +139,9 @@ void Socket::ReadHandlerInternal(boost::system::error_code error, size_t transfe
         return;
     }
 
+    static MetricCounter& received = sMetrics->GetCounter("ships_network_received_bytes_total", "Bytes read from client sockets");
+    received.Add(transferredBytes);
+
     _readBuffer.WriteCompleted(transferredBytes);
     ReadHandler();
 }
@@ -116,68 +151,44 @@ void Socket::ReadHandler()
     if (!IsOpen())
         return;
 
-    MessageBuffer& packet = GetReadBuffer();
-    while (packet.GetActiveSize() > 0)
+    if (!_framer.Process(GetReadBuffer(), *this))
     {
-        if (_headerBuffer.GetRemainingSpace() > 0)
-        {
-            // need to receive the header
-            std::size_t readHeaderSize = std::min(packet.GetActiveSize(), _headerBuffer.GetRemainingSpace());
-            _headerBuffer.Write(packet.GetReadPointer(), readHeaderSize);
-            packet.ReadCompleted(readHeaderSize);
-
-            if (_headerBuffer.GetRemainingSpace() > 0)
-                break;
-
-            // We just received nice new header
-            if (!ReadHeaderHandler())
-            {
-                CloseSocket();
-                return;
-            }
-        }
-
-        // We have full read header, now check the data payload
-        if (_packetBuffer.GetRemainingSpace() > 0)
-        {
-            // need more data in the payload
-            std::size_t readDataSize = std::min(packet.GetActiveSize(), _packetBuffer.GetRemainingSpace());
-            _packetBuffer.Write(packet.GetReadPointer(), readDataSize);
-            packet.ReadCompleted(readDataSize);
-
-            if (_packetBuffer.GetRemainingSpace() > 0)
-            {
-                // Couldn't receive the whole data this time.
-                break;
-            }
-        }
-        // just received fresh new payload
-        if (!ReadDataHandler())
-        {
-            CloseSocket();
-            _headerBuffer.Reset();
-            return;
-        }
-
-        _headerBuffer.Reset();
+        CloseSocket();
+        return;
     }
 
     AsyncRead();
 }
 
-bool Socket::ReadHeaderHandler()
+bool Socket::ReadHeaderHandler(ClientHeader const& header)
 {
-    ClientHeader* header = reinterpret_cast<ClientHeader*>(_headerBuffer.GetReadPointer());
-    uint32 opcode = header->Command;
-    uint32 size = header->Size;
+    uint32 opcode = header.Command;
+    uint32 size = header.Size;
 
     if (!ClientHeader::IsValidSize(size) || !ClientHeader::IsValidOpcode(opcode))
     {
-        std::cout << "Socket::ReadHeaderHandler(): client " << GetRemoteIpAddress().to_string().c_str() << " sent malformed packet (size: " << size << ", cmd: " << opcode << ")" << std::endl;
+        LOG_ERROR("network", "Socket::ReadHeaderHandler(): client {} sent malformed packet (size: {}, cmd: {})", GetRemoteIpAddress().to_string(), size, opcode);
+        RejectedPackets().Add();
+        return false;
+    }
+
+    // checked before the payload buffer is sized, an oversized packet never gets memory
+    OpcodeHandler const& opHandle = opcodeTable[opcode];
+    if (size > opHandle.maxSize)
+    {
+        LOG_ERROR("network", "Socket::ReadHeaderHandler(): client {} sent oversized {} (size: {}, max: {})", GetRemoteIpAddress().to_string(), opHandle.name, size, opHandle.maxSize);
+        RejectedPackets().Add();
+        return false;
+    }
+
+    bool authed = _authed.load(std::memory_order_acquire);
+    if (opHandle.status == STATUS_NEVER || (opHandle.status == STATUS_AUTHED) != authed)
+    {
+        LOG_ERROR("network", "Socket::ReadHeaderHandler(): client {} sent {} which is not allowed {} authentication", GetRemoteIpAddress().to_string(), opHandle.name, authed ? "after" : "before");
+        RejectedPackets().Add();
         return false;
     }
 
-    _packetBuffer.Resize(size);
     return true;
 }
 
@@ -200,6 +211,7 @@ bool Socket::WriteHandler(std::unique_lock<std::mutex>& guard)
 
     boost::system::error_code error;
     std::size_t bytesWritten = _socket.write_some(boost::asio::buffer(_writeBuffer.GetReadPointer(), bytesToSend), error);
+    SentBytes().Add(bytesWritten);
 
     if (error)
     {
@@ -234,6 +246,7 @@ bool Socket::HandleQueue(std::unique_lock<std::mutex>& guard)
 
     boost::system::error_code error;
     std::size_t bytesSent = _socket.write_some(boost::asio::buffer(queuedMessage.GetReadPointer(), bytesToSend), error);
+    SentBytes().Add(bytesSent);
 
     if (error)
     {
@@ -272,6 +285,7 @@ void Socket::SendPacket(Packet const& packet)
 
     uint32 packetSize = packet.size();
     uint32 sizeOfHeader = SizeOfServerHeader;
+    sOpcodeStats->RecordSent(packet.GetOpcode(), packetSize);
     std::unique_lock<std::mutex> guard(_writeLock);
 
     MessageBuffer buffer(sizeOfHeader + packetSize);
@@ -279,6 +293,24 @@ void Socket::SendPacket(Packet const& packet)
     QueuePacket(std::move(buffer), guard);
 }
 
+void Socket::SendPacket(Packet&& packet)
+{
+    if (!IsOpen())
+        return;
+
+    // received packets have no header room, those take the copying path
+    if (!packet.HasHeaderRoom())
+    {
+        SendPacket(static_cast<Packet const&>(packet));
+        return;
+    }
+
+    sOpcodeStats->RecordSent(packet.GetOpcode(), uint32(packet.size()));
+    MessageBuffer buffer(packet.MoveWithHeader());
+    std::unique_lock<std::mutex> guard(_writeLock);
+    QueuePacket(std::move(buffer), guard);
+}
+
 void Socket::WritePacketToBuffer(Packet const& packet, MessageBuffer& buffer)
 {
     ServerHeader header;
@@ -314,35 +346,56 @@ bool Socket::AsyncProcessQueue(std::unique_lock<std::mutex>&)
     return false;
 }
 
-bool Socket::ReadDataHandler()
+bool Socket::ReadDataHandler(ClientHeader const& header, MessageBuffer& payload)
 {
-    ClientHeader* header = reinterpret_cast<ClientHeader*>(_headerBuffer.GetReadPointer());
+    Packet packet(header.Command, std::move(payload));
 
-    Packet packet(header->Command, std::move(_packetBuffer));
+    // ReadHeaderHandler has checked the opcode and the session status
+    OpcodeHandler const& opHandle = opcodeTable[header.Command];
+    if (opHandle.processing == PROCESS_INPLACE && opHandle.status == STATUS_UNAUTHED)
+    {
+        switch (header.Command)
+        {
+            case CMSG_AUTH:
+                HandleAuth(packet);
+                break;
+            case CMSG_REGISTRATION:
+                HandleRegistration(packet);
+                break;
+            default:
+                break;
+        }
 
-    if (packet.GetOpcode() >= NUM_MSG_TYPES)
         return true;
+    }
 
-    switch (header->Command)
+    Session* session;
     {
-        case CMSG_AUTH:
-        {
-            HandleAuth(packet);
-            break;
-        }
-        default:
-        {
-            std::lock_guard<std::mutex> guard(_sessionLock);
+        // the session is only deleted after it has cleared _session under this lock
+        std::lock_guard<std::mutex> guard(_sessionLock);
 
-            if (!_session)
-                break;
+        if (!_session)
+            return true;
 
-            _session->QueuePacket(new Packet(std::move(packet)));
-            break;
-        }
+        // flooding faster than the updates drain it, ReadHandler closes the socket
+        if (opHandle.processing != PROCESS_INPLACE)
+            return _session->QueuePacket(std::move(packet));
+
+        // pinned instead of locked for the handler, CloseSocket waits for it before the session can go
+        session = _session;
+        _inplaceThread = std::this_thread::get_id();
     }
 
-    return true;
+    // no need to wait for the update, a malformed packet drops the client like a kick would
+    bool valid = session->HandleInplacePacket(packet);
+
+    {
+        std::lock_guard<std::mutex> guard(_sessionLock);
+        _inplaceThread = std::thread::id();
+    }
+    _inplaceDone.notify_all();
+
+    return valid;
 }
 
 void Socket::HandleAuth(Packet& packet)
@@ -351,6 +404,30 @@ void Socket::HandleAuth(Packet& packet)
     packet >> s1;
     packet >> s1;
 
-    std::cout << s1 << " : " << s2 << std::endl;
+    LOG_DEBUG("network", "Socket::HandleAuth: {} : {}", s1, s2);
     CloseSocket();
 }
+
+void Socket::HandleRegistration(Packet& packet)
+{
+    std::string account, password;
+    packet >> account;
+    packet >> password;
+
+    // there is no account storage yet; debug only, the account string comes from an unauthed client
+    LOG_DEBUG("network", "Socket::HandleRegistration: registration of {} refused, not supported", account);
+
+    // one answer per connection, repeating the request only costs the client its connection
+    if (_registrationAnswered)
+    {
+        CloseSocket();
+        return;
+    }
+
+    _registrationAnswered = true;
+
+    // refused but answered, the client may go on to CMSG_AUTH
+    Packet response(SMSG_REGISTRATION_RESPONSE, 1);
+    response << uint8(REGISTRATION_REFUSED);
+    SendPacket(std::move(response));
+}
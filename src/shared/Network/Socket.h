@@ -16,12 +16,15 @@
 #ifndef __SOCKET_H__
 #define __SOCKET_H__
 
+#include <condition_variable>
 #include <mutex>
 #include <memory>
+#include <thread>
 
 #include "Define.h"
 #include "Opcodes.h"
 #include "MessageBuffer.h"
+#include "PacketFramer.h"
 
 #include <boost/asio/ip/tcp.hpp>
 
@@ -29,19 +32,11 @@ class MessageBuffer;
 class Session;
 class Packet;
 
-struct ClientHeader
-{
-    uint16 Command;
-    uint16 Size;
-
-    static bool IsValidSize(uint32 size) { return size < 10240; }
-    static bool IsValidOpcode(uint32 opcode) { return opcode < NUM_OPCODE_HANDLERS; }
-};
-
 #define READ_BLOCK_SIZE 4096
 
 class Socket : public std::enable_shared_from_this<Socket>
 {
+    friend class PacketFramer;
 public:
      explicit Socket(boost::asio::ip::tcp::socket&& socket);
     ~Socket();
@@ -72,25 +67,31 @@ private:
     void ReadHandlerInternal(boost::system::error_code error, size_t transferredBytes);
     void ReadHandler();
 
-    bool ReadHeaderHandler();
+    bool ReadHeaderHandler(ClientHeader const& header);
     void WriteHandlerWrapper(boost::system::error_code /*error*/, std::size_t /*transferedBytes*/);
     bool WriteHandler(std::unique_lock<std::mutex>& guard);
     bool HandleQueue(std::unique_lock<std::mutex>& guard);
 
     // Handlers
     void HandleAuth(Packet& packet);
+    void HandleRegistration(Packet& packet);
 public:
     void SendPacket(Packet const& packet);
+    // hands the packet storage to the write queue without copying, the packet is left empty
+    void SendPacket(Packet&& packet);
     void SetSession(Session* session);
 private:
     void QueuePacket(MessageBuffer&& buffer, std::unique_lock<std::mutex>&);
     bool AsyncProcessQueue(std::unique_lock<std::mutex>&);
-    bool ReadDataHandler();
+    bool ReadDataHandler(ClientHeader const& header, MessageBuffer& payload);
     void WritePacketToBuffer(Packet const& packet, MessageBuffer& buffer);
 
     std::mutex _sessionLock;
     Session* _session;
-    bool _authed;
+    std::thread::id _inplaceThread;                         // running an in-place handler on _session, guarded by _sessionLock
+    std::condition_variable _inplaceDone;
+    std::atomic<bool> _authed;                             // read by ReadHeaderHandler without _sessionLock
+    bool _registrationAnswered;                             // network thread only, SMSG_REGISTRATION_RESPONSE is sent once
 
     boost::asio::ip::address _remoteAddress;
     uint16 _remotePort;
@@ -99,8 +100,7 @@ private:
 
     MessageBuffer _readBuffer;
 
-    MessageBuffer _headerBuffer;
-    MessageBuffer _packetBuffer;
+    PacketFramer _framer;
 
     std::atomic<bool> _closed;
     std::atomic<bool> _closing;
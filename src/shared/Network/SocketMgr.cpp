@@ -15,6 +15,7 @@
 
 #include "SocketMgr.h"
 #include "Socket.h"
+#include "Log.h"
 
 static void OnSocketAccept(tcp::socket&& sock)
 {
@@ -27,7 +28,7 @@ bool SocketMgr::StartNetwork(boost::asio::io_service& service, std::string const
 
     if (_threadCount <= 0)
     {
-        std::cout << "Network.Threads is wrong in your config file" << std::endl;
+        LOG_ERROR("network", "Network.Threads is wrong in your config file");
         return false;
     }
 
@@ -37,7 +38,7 @@ bool SocketMgr::StartNetwork(boost::asio::io_service& service, std::string const
     }
     catch (boost::system::system_error const& err)
     {
-        std::cout << "Exception caught in SocketMgr.StartNetwork (" << bindIp.c_str() << ":" << port << "): " << err.what();
+        LOG_ERROR("network", "Exception caught in SocketMgr.StartNetwork ({}:{}): {}", bindIp, port, err.what());
         return false;
     }
 
@@ -82,7 +83,7 @@ void SocketMgr::OnSocketOpen(tcp::socket&& sock)
         sock.set_option(boost::asio::ip::tcp::no_delay(true), err);
         if (err)
         {
-            std::cout << "SocketMgr::OnSocketOpen sock.set_option(boost::asio::ip::tcp::no_delay) err = " << err.message().c_str() << std::endl;
+            LOG_ERROR("network", "SocketMgr::OnSocketOpen sock.set_option(boost::asio::ip::tcp::no_delay) err = {}", err.message());
             return;
         }
     }
@@ -97,11 +98,11 @@ void SocketMgr::OnSocketOpen(tcp::socket&& sock)
         std::shared_ptr<Socket> newSocket = std::make_shared<Socket>(std::move(sock));
         newSocket->Start();
 
-        std::cout << "Socket Open" << std::endl;
+        LOG_DEBUG("network", "Socket Open");
         _threads[min].AddSocket(newSocket);
     }
     catch (boost::system::system_error const& err)
     {
-        std::cout << "Failed to retrieve client's remote address " << err.what() << std::endl;
+        LOG_ERROR("network", "Failed to retrieve client's remote address {}", err.what());
     }
 }
@@ -0,0 +1,179 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _BITSTREAM_H
+#define _BITSTREAM_H
+
+#include "ByteBuffer.h"
+
+/**
+  * Packs fields of arbitrary width into a ByteBuffer through a 64-bit accumulator.
+  * Bits are stored most significant first, the same layout as ByteBuffer::WriteBits,
+  * but the buffer is only touched once per 64 bits.
+  * Starts on a byte boundary and pads the last byte with zeros on Flush().
+  *
+  * Usage:
+  *     BitWriter bits(packet);
+  *     bits.Write(x, 11);
+  *     bits.Write(y, 11);
+  *     bits.Flush();
+*/
+class BitWriter
+{
+    public:
+        explicit BitWriter(ByteBuffer& buffer) : _buffer(buffer), _acc(0), _count(0)
+        {
+            _buffer.FlushBits();
+        }
+
+        ~BitWriter() { Flush(); }
+
+        /// Writes the low bitCount bits of value, bitCount must be in range 1..64
+        void Write(uint64 value, uint32 bitCount)
+        {
+            if (bitCount < 64)
+                value &= (uint64(1) << bitCount) - 1;
+
+            uint32 freeBits = 64 - _count;
+            if (bitCount < freeBits)
+            {
+                _acc |= value << (freeBits - bitCount);
+                _count += bitCount;
+                return;
+            }
+
+            // fills the accumulator, the remainder starts the next word
+            uint32 rest = bitCount - freeBits;
+            _acc |= value >> rest;
+            WriteWord(8);
+            _acc = rest ? value << (64 - rest) : 0;
+            _count = rest;
+        }
+
+        void WriteBit(bool bit) { Write(bit ? 1 : 0, 1); }
+
+        /// Writes out pending bits, padding the last byte
+        void Flush()
+        {
+            if (_count)
+                WriteWord((_count + 7) / 8);
+
+            _acc = 0;
+            _count = 0;
+        }
+
+    private:
+        void WriteWord(size_t bytes)
+        {
+            uint8* dest = _buffer.append_uninitialized(bytes);
+            for (size_t i = 0; i < bytes; ++i)
+                dest[i] = uint8(_acc >> (56 - 8 * i));
+        }
+
+        ByteBuffer& _buffer;
+        uint64 _acc;
+        uint32 _count;
+
+        BitWriter(BitWriter const& right) = delete;
+        BitWriter& operator=(BitWriter const& right) = delete;
+};
+
+/**
+  * Reads fields written by BitWriter (or ByteBuffer::WriteBits from a byte boundary).
+  * Refills a 64-bit accumulator from the buffer's read position a word at a time;
+  * Finish() (or the destructor) leaves the read position after the last consumed byte.
+*/
+class BitReader
+{
+    public:
+        explicit BitReader(ByteBuffer& buffer) : _buffer(buffer), _acc(0), _count(0), _pos(buffer.rpos())
+        {
+            _buffer.ResetBitPos();
+        }
+
+        ~BitReader() { Finish(); }
+
+        /// Reads bitCount bits, bitCount must be in range 1..64
+        uint64 Read(uint32 bitCount)
+        {
+            if (bitCount > _count)
+            {
+                // take what is left, then continue from a fresh word
+                uint32 high = _count;
+                uint64 value = high ? _acc >> (64 - high) : 0;
+                Refill(bitCount - high);
+
+                uint32 low = bitCount - high;
+                value = high ? (value << low) : 0;
+                value |= _acc >> (64 - low);
+                Consume(low);
+                return value;
+            }
+
+            uint64 value = _acc >> (64 - bitCount);
+            Consume(bitCount);
+            return value;
+        }
+
+        bool ReadBit() { return Read(1) != 0; }
+
+        /// Drops the rest of the current byte and syncs the buffer read position
+        void Finish()
+        {
+            _buffer.rpos(_pos - _count / 8);
+            _acc = 0;
+            _count = 0;
+            _pos = _buffer.rpos();
+        }
+
+    private:
+        void Consume(uint32 bitCount)
+        {
+            _acc = bitCount < 64 ? _acc << bitCount : 0;
+            _count -= bitCount;
+        }
+
+        // loads at least minBits into an empty accumulator
+        void Refill(uint32 minBits)
+        {
+            size_t available = _pos < _buffer.size() ? _buffer.size() - _pos : 0;
+            size_t bytes = available < 8 ? available : 8;
+            if (bytes * 8 < minBits && !_buffer.CheckRead(_pos, (minBits + 7) / 8))
+            {
+                // checked reads: hand out zeros without moving
+                _acc = 0;
+                _count = minBits;
+                return;
+            }
+
+            uint8 const* src = _buffer.contents() + _pos;
+            _acc = 0;
+            for (size_t i = 0; i < bytes; ++i)
+                _acc |= uint64(src[i]) << (56 - 8 * i);
+
+            _pos += bytes;
+            _count = uint32(bytes * 8);
+        }
+
+        ByteBuffer& _buffer;
+        uint64 _acc;
+        uint32 _count;
+        size_t _pos;
+
+        BitReader(BitReader const& right) = delete;
+        BitReader& operator=(BitReader const& right) = delete;
+};
+
+#endif
@@ -16,32 +16,266 @@
 #include "ByteBuffer.h"
 #include "MessageBuffer.h"
 
+#include <algorithm>
 #include <sstream>
 
-ByteBuffer::ByteBuffer(MessageBuffer&& buffer) : _rpos(0), _wpos(0), _bitpos(InitialBitPos), _curbitval(0), _storage(buffer.Move())
+#if COMPILER == COMPILER_GNU && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define PACKXYZ_AVX2 1
+#else
+#define PACKXYZ_AVX2 0
+#endif
+
+ByteBuffer::ByteBuffer(MessageBuffer&& buffer) : _rpos(0), _wpos(0), _bitpos(InitialBitPos), _curbitval(0),
+    _checkedReads(false), _readError(false), _storage(buffer.Move())
+{
+}
+
+namespace
+{
+    // Kernels for the batched appendPackXYZ/readPackXYZ, they work on host order words.
+    // x / 0.25f is exactly x * 4.0f and cvttps truncates like the (int) cast, so all of them match the scalar format.
+    typedef void (*PackXYZFn)(float const* x, float const* y, float const* z, uint8* dest, size_t count);
+    typedef void (*UnpackXYZFn)(uint32 const* src, float* x, float* y, float* z, size_t count);
+
+    void PackXYZScalar(float const* x, float const* y, float const* z, uint8* dest, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32 packed = 0;
+            packed |= ((int)(x[i] * 4.0f) & 0x7FF);
+            packed |= ((int)(y[i] * 4.0f) & 0x7FF) << 11;
+            packed |= ((int)(z[i] * 4.0f) & 0x3FF) << 22;
+            std::memcpy(dest + i * sizeof(uint32), &packed, sizeof(uint32));
+        }
+    }
+
+    void UnpackXYZScalar(uint32 const* src, float* x, float* y, float* z, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            x[i] = float(int32(src[i] << 21) >> 21) * 0.25f;
+            y[i] = float(int32(src[i] << 10) >> 21) * 0.25f;
+            z[i] = float(int32(src[i]) >> 22) * 0.25f;
+        }
+    }
+
+#if defined(__SSE2__) || defined(_M_X64)
+    void PackXYZSSE2(float const* x, float const* y, float const* z, uint8* dest, size_t count)
+    {
+        __m128 const scale = _mm_set1_ps(4.0f);
+        __m128i const mask = _mm_set1_epi32(0x7FF);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i qx = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(x + i), scale));
+            __m128i qy = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(y + i), scale));
+            __m128i qz = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(z + i), scale));
+
+            // z needs no mask, the shift drops everything above its 10 bits
+            __m128i packed = _mm_or_si128(_mm_and_si128(qx, mask),
+                _mm_or_si128(_mm_slli_epi32(_mm_and_si128(qy, mask), 11), _mm_slli_epi32(qz, 22)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * sizeof(uint32)), packed);
+        }
+
+        PackXYZScalar(x + i, y + i, z + i, dest + i * sizeof(uint32), count - i);
+    }
+
+    void UnpackXYZSSE2(uint32 const* src, float* x, float* y, float* z, size_t count)
+    {
+        __m128 const scale = _mm_set1_ps(0.25f);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i packed = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src + i));
+            _mm_storeu_ps(x + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(packed, 21), 21)), scale));
+            _mm_storeu_ps(y + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(packed, 10), 21)), scale));
+            _mm_storeu_ps(z + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(packed, 22)), scale));
+        }
+
+        UnpackXYZScalar(src + i, x + i, y + i, z + i, count - i);
+    }
+#endif
+
+#if PACKXYZ_AVX2
+    __attribute__((target("avx2"))) void PackXYZAVX2(float const* x, float const* y, float const* z, uint8* dest, size_t count)
+    {
+        __m256 const scale = _mm256_set1_ps(4.0f);
+        __m256i const mask = _mm256_set1_epi32(0x7FF);
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i qx = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(x + i), scale));
+            __m256i qy = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(y + i), scale));
+            __m256i qz = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(z + i), scale));
+
+            __m256i packed = _mm256_or_si256(_mm256_and_si256(qx, mask),
+                _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(qy, mask), 11), _mm256_slli_epi32(qz, 22)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i * sizeof(uint32)), packed);
+        }
+
+        PackXYZScalar(x + i, y + i, z + i, dest + i * sizeof(uint32), count - i);
+    }
+
+    __attribute__((target("avx2"))) void UnpackXYZAVX2(uint32 const* src, float* x, float* y, float* z, size_t count)
+    {
+        __m256 const scale = _mm256_set1_ps(0.25f);
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i packed = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i));
+            _mm256_storeu_ps(x + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(packed, 21), 21)), scale));
+            _mm256_storeu_ps(y + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(packed, 10), 21)), scale));
+            _mm256_storeu_ps(z + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(packed, 22)), scale));
+        }
+
+        UnpackXYZScalar(src + i, x + i, y + i, z + i, count - i);
+    }
+#endif
+
+    bool HasAVX2()
+    {
+#if PACKXYZ_AVX2
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+#else
+        return false;
+#endif
+    }
+
+    PackXYZFn SelectPackXYZ()
+    {
+#if PACKXYZ_AVX2
+        if (HasAVX2())
+            return PackXYZAVX2;
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+        return PackXYZSSE2;
+#else
+        return PackXYZScalar;
+#endif
+    }
+
+    UnpackXYZFn SelectUnpackXYZ()
+    {
+#if PACKXYZ_AVX2
+        if (HasAVX2())
+            return UnpackXYZAVX2;
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+        return UnpackXYZSSE2;
+#else
+        return UnpackXYZScalar;
+#endif
+    }
+}
+
+void ByteBuffer::appendPackXYZ(float const* x, float const* y, float const* z, size_t count)
+{
+    static PackXYZFn const pack = SelectPackXYZ();
+
+    if (!count)
+        return;
+
+    uint8* dest = append_uninitialized(count * sizeof(uint32));
+    pack(x, y, z, dest, count);
+    EndianConvertArray<uint32>(dest, count);
+}
+
+void ByteBuffer::readPackXYZ(float* x, float* y, float* z, size_t count)
+{
+    static UnpackXYZFn const unpack = SelectUnpackXYZ();
+
+    // count * 4 could wrap around on a bogus count
+    if (count > size() / sizeof(uint32))
+        ReadFailed(_rpos, count);
+
+    if (count > size() / sizeof(uint32) || !CheckRead(_rpos, count * sizeof(uint32)))
+    {
+        std::memset(x, 0, count * sizeof(float));
+        std::memset(y, 0, count * sizeof(float));
+        std::memset(z, 0, count * sizeof(float));
+        return;
+    }
+
+    ResetBitPos();
+
+    // converted a block at a time through the stack, the contents stay untouched
+    uint32 words[256];
+    for (size_t done = 0; done < count;)
+    {
+        size_t block = std::min<size_t>(count - done, 256);
+        std::memcpy(words, &_storage[_rpos], block * sizeof(uint32));
+        EndianConvertArray<uint32>(words, block);
+        unpack(words, x + done, y + done, z + done, block);
+        _rpos += block * sizeof(uint32);
+        done += block;
+    }
+}
+
+char const* ByteBufferPositionException::what() const throw()
 {
+    if (message().empty())
+    {
+        std::ostringstream ss;
+
+        ss << "Attempted to " << (_add ? "put" : "get") << " value with size: "
+           << _valueSize << " in ByteBuffer (pos: " << _pos << " size: " << _size
+           << ")";
+
+        message().assign(ss.str());
+    }
+
+    return ByteBufferException::what();
 }
 
-ByteBufferPositionException::ByteBufferPositionException(bool add, size_t pos, size_t size, size_t valueSize)
+char const* ByteBufferSourceException::what() const throw()
 {
-    std::ostringstream ss;
+    if (message().empty())
+    {
+        std::ostringstream ss;
+
+        ss << "Attempted to put a "
+           << (_valueSize > 0 ? "NULL-pointer" : "zero-sized value")
+           << " in ByteBuffer (pos: " << _pos << " size: " << _size << ")";
 
-    ss << "Attempted to " << (add ? "put" : "get") << " value with size: "
-       << valueSize << " in ByteBuffer (pos: " << pos << " size: " << size
-       << ")";
+        message().assign(ss.str());
+    }
 
-    message().assign(ss.str());
+    return ByteBufferException::what();
 }
 
-ByteBufferSourceException::ByteBufferSourceException(size_t pos, size_t size, size_t valueSize)
+void ByteBuffer::ReadFailed(size_t pos, size_t len) const
 {
-    std::ostringstream ss;
+    if (!_checkedReads)
+        throw ByteBufferPositionException(false, pos, size(), len);
 
-    ss << "Attempted to put a "
-       << (valueSize > 0 ? "NULL-pointer" : "zero-sized value")
-       << " in ByteBuffer (pos: " << pos << " size: " << size << ")";
+    _readError = true;
+}
+
+uint64 ByteBuffer::ReadVarUIntSlow()
+{
+    uint64 value = 0;
+    for (uint32 i = 0; i < MAX_VARINT_SIZE; ++i)
+    {
+        uint8 byte = read<uint8>();
+        value |= uint64(byte & 0x7F) << (i * 7);
+        if (!(byte & 0x80))
+        {
+            // the 10th byte may only carry the top bit of a 64-bit value
+            if (i == MAX_VARINT_SIZE - 1 && byte > 1)
+                break;
+
+            return value;
+        }
+    }
 
-    message().assign(ss.str());
+    ValueFailed();
+    return 0;
 }
 
 void ByteBuffer::print_storage() const
@@ -18,6 +18,7 @@
 
 #include "Define.h"
 #include "ByteConverter.h"
+#include "ByteBufferStorage.h"
 
 #include <exception>
 #include <list>
@@ -28,11 +29,20 @@
 #include <time.h>
 #include <cmath>
 #include <type_traits>
+#include <limits>
+#include <cstddef>
 #include <boost/asio/buffer.hpp>
 
+#if defined(__BMI2__)
+#include <immintrin.h>
+#elif COMPILER == COMPILER_MICROSOFT
+#include <intrin.h>
+#endif
+
 class MessageBuffer;
 
 // Root of ByteBuffer exception hierarchy
+// Messages are only formatted when what() is called, throwing does not allocate
 class ByteBufferException : public std::exception
 {
 public:
@@ -41,59 +51,73 @@ public:
     char const* what() const throw() override { return msg_.c_str(); }
 
 protected:
-    std::string & message() throw() { return msg_; }
+    std::string & message() const throw() { return msg_; }
 
 private:
-    std::string msg_;
+    mutable std::string msg_;
 };
 
 class ByteBufferPositionException : public ByteBufferException
 {
 public:
-    ByteBufferPositionException(bool add, size_t pos, size_t size, size_t valueSize);
+    ByteBufferPositionException(bool add, size_t pos, size_t size, size_t valueSize) :
+        _add(add), _pos(pos), _size(size), _valueSize(valueSize) { }
 
     ~ByteBufferPositionException() throw() { }
+
+    char const* what() const throw() override;
+
+private:
+    bool _add;
+    size_t _pos;
+    size_t _size;
+    size_t _valueSize;
 };
 
 class ByteBufferSourceException : public ByteBufferException
 {
 public:
-    ByteBufferSourceException(size_t pos, size_t size, size_t valueSize);
+    ByteBufferSourceException(size_t pos, size_t size, size_t valueSize) :
+        _pos(pos), _size(size), _valueSize(valueSize) { }
 
     ~ByteBufferSourceException() throw() { }
+
+    char const* what() const throw() override;
+
+private:
+    size_t _pos;
+    size_t _size;
+    size_t _valueSize;
 };
 
 class ByteBuffer
 {
     public:
-        static size_t const DEFAULT_SIZE = 0x1000;
         static uint8 const InitialBitPos = 8;
 
-        // constructor
-        ByteBuffer() : _rpos(0), _wpos(0), _bitpos(InitialBitPos), _curbitval(0)
-        {
-            _storage.reserve(DEFAULT_SIZE);
-        }
+        // constructor, contents start in the inline storage and only go to the heap when they outgrow it
+        ByteBuffer() : _rpos(0), _wpos(0), _bitpos(InitialBitPos), _curbitval(0), _checkedReads(false), _readError(false) { }
 
-        ByteBuffer(size_t reserve) : _rpos(0), _wpos(0), _bitpos(InitialBitPos), _curbitval(0)
+        ByteBuffer(size_t reserve) : _rpos(0), _wpos(0), _bitpos(InitialBitPos), _curbitval(0), _checkedReads(false), _readError(false)
         {
             _storage.reserve(reserve);
         }
 
-        ByteBuffer(ByteBuffer&& buf) : _rpos(buf._rpos), _wpos(buf._wpos),
-            _bitpos(buf._bitpos), _curbitval(buf._curbitval), _storage(buf.Move()) { }
+        ByteBuffer(ByteBuffer&& buf) : _rpos(buf._rpos), _wpos(buf._wpos), _bitpos(buf._bitpos), _curbitval(buf._curbitval),
+            _checkedReads(buf._checkedReads), _readError(buf._readError), _storage(buf.Move()) { }
 
-        ByteBuffer(ByteBuffer const& right) : _rpos(right._rpos), _wpos(right._wpos),
-            _bitpos(right._bitpos), _curbitval(right._curbitval), _storage(right._storage) { }
+        ByteBuffer(ByteBuffer const& right) : _rpos(right._rpos), _wpos(right._wpos), _bitpos(right._bitpos), _curbitval(right._curbitval),
+            _checkedReads(right._checkedReads), _readError(right._readError), _storage(right._storage) { }
 
         ByteBuffer(MessageBuffer&& buffer);
 
-        std::vector<uint8>&& Move()
+        ByteBufferStorage&& Move()
         {
             _rpos = 0;
             _wpos = 0;
             _bitpos = InitialBitPos;
             _curbitval = 0;
+            _readError = false;
             return std::move(_storage);
         }
 
@@ -105,6 +129,8 @@ class ByteBuffer
                 _wpos = right._wpos;
                 _bitpos = right._bitpos;
                 _curbitval = right._curbitval;
+                _checkedReads = right._checkedReads;
+                _readError = right._readError;
                 _storage = right._storage;
             }
 
@@ -119,6 +145,8 @@ class ByteBuffer
                 _wpos = right._wpos;
                 _bitpos = right._bitpos;
                 _curbitval = right._curbitval;
+                _checkedReads = right._checkedReads;
+                _readError = right._readError;
                 _storage = right.Move();
             }
 
@@ -133,9 +161,40 @@ class ByteBuffer
             _wpos = 0;
             _bitpos = InitialBitPos;
             _curbitval = 0;
+            _readError = false;
             _storage.clear();
         }
 
+        /**
+          * @name   SetCheckedReads
+          * @brief  In checked mode reading past the end or reading a malformed value does not throw.
+          *         The read returns 0 (or an empty string) and sets a sticky error flag, so a handler
+          *         can read all of its fields and validate them once with HasReadError().
+          *         Nothing is allocated on the error path.
+        */
+        void SetCheckedReads(bool checked) { _checkedReads = checked; }
+        bool HasCheckedReads() const { return _checkedReads; }
+        bool HasReadError() const { return _readError; }
+
+        /// Returns true if len bytes can be read at pos, otherwise throws or, in checked mode, flags the error
+        bool CheckRead(size_t pos, size_t len) const
+        {
+            if (pos + len <= size() && pos + len >= pos)
+                return true;
+
+            ReadFailed(pos, len);
+            return false;
+        }
+
+        /// Reports a value that was read but is not valid, throws unless in checked mode
+        void ValueFailed() const
+        {
+            if (!_checkedReads)
+                throw ByteBufferException();
+
+            _readError = true;
+        }
+
         template <typename T> void append(T value)
         {
             static_assert(std::is_fundamental<T>::value, "append(compound)");
@@ -191,20 +250,77 @@ class ByteBuffer
             return ((_curbitval >> (7-_bitpos)) & 1) != 0;
         }
 
+        // Same bit order as calling WriteBit for every bit, but fills the pending byte
+        // with a single shift and appends whole bytes at once when aligned
         template <typename T> void WriteBits(T value, size_t bits)
         {
-            for (int32 i = bits-1; i >= 0; --i)
-                WriteBit((value >> i) & 1);
+            uint64 v = uint64(value);
+            if (bits < 64)
+                v &= (uint64(1) << bits) - 1;
+
+            while (bits)
+            {
+                if (_bitpos == 8 && bits >= 8)
+                {
+                    uint8 bytes[8];
+                    size_t count = bits / 8;
+                    for (size_t i = 0; i < count; ++i)
+                        bytes[i] = uint8(v >> (bits - 8 * (i + 1)));
+
+                    append(bytes, count);
+                    bits -= count * 8;
+                    continue;
+                }
+
+                size_t take = bits < _bitpos ? bits : _bitpos;
+                _curbitval |= uint8(((v >> (bits - take)) & ((1u << take) - 1)) << (_bitpos - take));
+                _bitpos -= take;
+                bits -= take;
+
+                if (_bitpos == 0)
+                {
+                    _bitpos = 8;
+                    append((uint8 *)&_curbitval, sizeof(_curbitval));
+                    _curbitval = 0;
+                }
+            }
         }
 
+        // Counterpart of WriteBits, consumes whole bytes at once when aligned
         uint32 ReadBits(size_t bits)
         {
-            uint32 value = 0;
-            for (int32 i = bits-1; i >= 0; --i)
-                if (ReadBit())
-                    value |= (1 << (i));
+            uint64 value = 0;
+            while (bits)
+            {
+                // bits of _curbitval not consumed yet
+                size_t avail = _bitpos < 7 ? 7 - _bitpos : 0;
+                if (!avail)
+                {
+                    if (bits >= 8)
+                    {
+                        uint8 bytes[8];
+                        size_t count = bits / 8 < 8 ? bits / 8 : 8;
+                        read(bytes, count);
+                        for (size_t i = 0; i < count; ++i)
+                            value = (value << 8) | bytes[i];
+
+                        bits -= count * 8;
+                        continue;
+                    }
+
+                    _curbitval = read<uint8>();
+                    value = (value << bits) | (_curbitval >> (8 - bits));
+                    _bitpos = bits - 1;
+                    break;
+                }
+
+                size_t take = bits < avail ? bits : avail;
+                value = (value << take) | ((_curbitval >> (avail - take)) & ((1u << take) - 1));
+                _bitpos += take;
+                bits -= take;
+            }
 
-            return value;
+            return uint32(value);
         }
 
         // Reads a byte (if needed) in-place
@@ -395,7 +511,10 @@ class ByteBuffer
         {
             value = read<float>();
             if (!std::isfinite(value))
-                throw ByteBufferException();
+            {
+                ValueFailed();
+                value = 0.0f;
+            }
             return *this;
         }
 
@@ -403,7 +522,10 @@ class ByteBuffer
         {
             value = read<double>();
             if (!std::isfinite(value))
-                throw ByteBufferException();
+            {
+                ValueFailed();
+                value = 0.0;
+            }
             return *this;
         }
 
@@ -470,8 +592,8 @@ class ByteBuffer
 
         void read_skip(size_t skip)
         {
-            if (_rpos + skip > size())
-                throw ByteBufferPositionException(false, _rpos, skip, size());
+            if (!CheckRead(_rpos, skip))
+                return;
 
             ResetBitPos();
             _rpos += skip;
@@ -480,30 +602,71 @@ class ByteBuffer
         template <typename T> T read()
         {
             ResetBitPos();
-            T r = read<T>(_rpos);
+            if (!CheckRead(_rpos, sizeof(T)))
+                return T();
+
+            T r = ReadAt<T>(_rpos);
             _rpos += sizeof(T);
             return r;
         }
 
         template <typename T> T read(size_t pos) const
         {
-            if (pos + sizeof(T) > size())
-                throw ByteBufferPositionException(false, pos, sizeof(T), size());
-            T val = *((T const*)&_storage[pos]);
-            EndianConvert(val);
-            return val;
+            if (!CheckRead(pos, sizeof(T)))
+                return T();
+
+            return ReadAt<T>(pos);
         }
 
         void read(uint8 *dest, size_t len)
         {
-            if (_rpos + len > size())
-               throw ByteBufferPositionException(false, _rpos, len, size());
+            if (!CheckRead(_rpos, len))
+            {
+                std::memset(dest, 0, len);
+                return;
+            }
 
             ResetBitPos();
             std::memcpy(dest, &_storage[_rpos], len);
             _rpos += len;
         }
 
+        /// Reads count values written by AppendArray
+        template <typename T> void ReadArray(T* dest, size_t count)
+        {
+            static_assert(std::is_arithmetic<T>::value, "ReadArray(compound)");
+            // an empty vector hands in data() == nullptr, memcpy/memset must not see it
+            if (!count)
+                return;
+
+            // count * sizeof(T) could wrap around on a bogus count
+            if (count > size() / sizeof(T))
+                ReadFailed(_rpos, count);
+
+            if (count > size() / sizeof(T) || !CheckRead(_rpos, count * sizeof(T)))
+            {
+                std::memset(dest, 0, count * sizeof(T));
+                return;
+            }
+
+            ResetBitPos();
+            std::memcpy(dest, &_storage[_rpos], count * sizeof(T));
+            EndianConvertArray<T>(dest, count);
+            _rpos += count * sizeof(T);
+
+            if (std::is_floating_point<T>::value)
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    if (!std::isfinite(double(dest[i])))
+                    {
+                        ValueFailed();
+                        dest[i] = T();
+                    }
+                }
+            }
+        }
+
         void ReadPackedUInt64(uint64& guid)
         {
             guid = 0;
@@ -517,10 +680,49 @@ class ByteBuffer
                     value |= (uint64(read<uint8>()) << (i * 8));
         }
 
+        /**
+          * @name   ReadVarUInt
+          * @brief  Reads an unsigned LEB128 value written by AppendVarUInt.
+          *         When 8 bytes are available the terminating byte is located with one
+          *         mask over a 64-bit load and the 7-bit groups are compacted in-register,
+          *         longer values and values at the end of the buffer take the byte loop.
+        */
+        uint64 ReadVarUInt()
+        {
+            ResetBitPos();
+
+            if (_rpos + 8 <= size())
+            {
+                uint8 const* src = &_storage[_rpos];
+                uint64 word = 0;
+                for (uint32 i = 0; i < 8; ++i)
+                    word |= uint64(src[i]) << (i * 8);
+
+                // high bit clear marks the last byte of the value
+                if (uint64 stops = ~word & 0x8080808080808080ULL)
+                {
+                    uint32 len = CountTrailingZeros(stops) / 8 + 1;
+                    if (len < 8)
+                        word &= (uint64(1) << (len * 8)) - 1;
+
+                    _rpos += len;
+                    return CompactVarUInt(word);
+                }
+            }
+
+            return ReadVarUIntSlow();
+        }
+
+        /// Reads a zigzag encoded signed value written by AppendVarInt
+        int64 ReadVarInt()
+        {
+            return ZigZagDecode(ReadVarUInt());
+        }
+
         std::string ReadString(uint32 length)
         {
-            if (_rpos + length > size())
-                throw ByteBufferPositionException(false, _rpos, length, size());
+            if (!CheckRead(_rpos, length))
+                return std::string();
 
             ResetBitPos();
             if (!length)
@@ -585,7 +787,7 @@ class ByteBuffer
 
         void resize(size_t newsize)
         {
-            _storage.resize(newsize, 0);
+            _storage.resize(newsize);
             _rpos = 0;
             _wpos = size();
         }
@@ -614,12 +816,48 @@ class ByteBuffer
             if (!src)
                 throw ByteBufferSourceException(_wpos, size(), cnt);
 
+            std::memcpy(append_uninitialized(cnt), src, cnt);
+        }
+
+        /**
+          * @name   append_uninitialized
+          * @brief  Grows the buffer by cnt bytes at the write position without initializing them
+          *         and returns a pointer to that space, for encoding values in place.
+          *         The pointer is invalidated by the next operation that grows the buffer.
+        */
+        uint8* append_uninitialized(size_t cnt)
+        {
             FlushBits();
 
-            if (_storage.size() < _wpos + cnt)
-                _storage.resize(_wpos + cnt);
-            std::memcpy(&_storage[_wpos], src, cnt);
+            size_t oldSize = _storage.size();
+            if (oldSize < _wpos + cnt)
+            {
+                _storage.resize_uninitialized(_wpos + cnt);
+
+                // write position was moved past the end, keep the gap zeroed as before
+                if (oldSize < _wpos)
+                    std::memset(_storage.data() + oldSize, 0, _wpos - oldSize);
+            }
+
+            uint8* dest = _storage.data() + _wpos;
             _wpos += cnt;
+            return dest;
+        }
+
+        /// Appends count values with the same byte order as append<T>, in a single copy
+        template <typename T> void AppendArray(T const* src, size_t count)
+        {
+            static_assert(std::is_arithmetic<T>::value, "AppendArray(compound)");
+            if (!count)
+                return;
+
+            // no object can be larger, also keeps count * sizeof(T) from wrapping around
+            if (count > size_t(std::numeric_limits<std::ptrdiff_t>::max()) / sizeof(T))
+                throw ByteBufferPositionException(true, _wpos, size(), count);
+
+            uint8* dest = append_uninitialized(count * sizeof(T));
+            std::memcpy(dest, src, count * sizeof(T));
+            EndianConvertArray<T>(dest, count);
         }
 
         void append(const ByteBuffer& buffer)
@@ -638,6 +876,24 @@ class ByteBuffer
             *this << packed;
         }
 
+        /**
+          * @name   appendPackXYZ
+          * @brief  Packs count positions given as separate x, y and z arrays into the appendPackXYZ(x, y, z) format.
+          *         Quantizes with SSE2 or AVX2, picked at runtime, so a whole fleet is packed in one pass.
+        */
+        void appendPackXYZ(float const* x, float const* y, float const* z, size_t count);
+
+        void readPackXYZ(float& x, float& y, float& z)
+        {
+            uint32 packed = read<uint32>();
+            x = float(int32(packed << 21) >> 21) * 0.25f;
+            y = float(int32(packed << 10) >> 21) * 0.25f;
+            z = float(int32(packed) >> 22) * 0.25f;
+        }
+
+        /// Reads count positions written by appendPackXYZ into separate x, y and z arrays
+        void readPackXYZ(float* x, float* y, float* z, size_t count);
+
         void AppendPackedUInt64(uint64 guid)
         {
             uint8 mask = 0;
@@ -671,6 +927,32 @@ class ByteBuffer
             return resultSize;
         }
 
+        /// Appends value as unsigned LEB128: 7 bits per byte, low groups first, high bit set on all but the last byte
+        void AppendVarUInt(uint64 value)
+        {
+            uint8 bytes[MAX_VARINT_SIZE];
+            size_t len = 0;
+            while (value >= 0x80)
+            {
+                bytes[len++] = uint8(value) | 0x80;
+                value >>= 7;
+            }
+
+            bytes[len++] = uint8(value);
+            append(bytes, len);
+        }
+
+        /// Appends value zigzag encoded so that small negative numbers stay short too
+        void AppendVarInt(int64 value)
+        {
+            AppendVarUInt(ZigZagEncode(value));
+        }
+
+        static uint64 ZigZagEncode(int64 value) { return (uint64(value) << 1) ^ uint64(value >> 63); }
+        static int64 ZigZagDecode(uint64 value) { return int64((value >> 1) ^ (~(value & 1) + 1)); }
+
+        static size_t const MAX_VARINT_SIZE = 10;
+
         void put(size_t pos, const uint8 *src, size_t cnt)
         {
             if (pos + cnt > size())
@@ -688,43 +970,122 @@ class ByteBuffer
 
         void hexlike() const;
 
+    private:
+        template <typename T> T ReadAt(size_t pos) const
+        {
+            T val;
+            std::memcpy(&val, &_storage[pos], sizeof(T));
+            EndianConvert(val);
+            return val;
+        }
+
+        void ReadFailed(size_t pos, size_t len) const;
+
+        uint64 ReadVarUIntSlow();
+
+        static uint32 CountTrailingZeros(uint64 value)
+        {
+#if COMPILER == COMPILER_GNU
+            return __builtin_ctzll(value);
+#elif COMPILER == COMPILER_MICROSOFT && defined(_M_X64)
+            unsigned long index;
+            _BitScanForward64(&index, value);
+            return index;
+#else
+            uint32 count = 0;
+            while (!(value & 1))
+            {
+                value >>= 1;
+                ++count;
+            }
+            return count;
+#endif
+        }
+
+        // packs the low 7 bits of every byte of word into a contiguous 56-bit value
+        static uint64 CompactVarUInt(uint64 word)
+        {
+#if defined(__BMI2__)
+            return _pext_u64(word, 0x7F7F7F7F7F7F7F7FULL);
+#else
+            word &= 0x7F7F7F7F7F7F7F7FULL;
+            word = ((word & 0x7F007F007F007F00ULL) >> 1) | (word & 0x007F007F007F007FULL);
+            word = ((word & 0x3FFF00003FFF0000ULL) >> 2) | (word & 0x00003FFF00003FFFULL);
+            word = ((word & 0x0FFFFFFF00000000ULL) >> 4) | (word & 0x000000000FFFFFFFULL);
+            return word;
+#endif
+        }
+
     protected:
         size_t _rpos, _wpos, _bitpos;
         uint8 _curbitval;
-        std::vector<uint8> _storage;
+        bool _checkedReads;
+        mutable bool _readError;
+        ByteBufferStorage _storage;
 };
 
+/// Element types that std::vector serialization copies in bulk through AppendArray/ReadArray
+template <typename T>
+struct IsBulkSerializable : std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<T, bool>::value> { };
+
 template <typename T>
-inline ByteBuffer &operator<<(ByteBuffer &b, std::vector<T> v)
+inline void AppendElements(ByteBuffer &b, std::vector<T> const& v, std::true_type)
 {
-    b << (uint32)v.size();
-    for (typename std::vector<T>::iterator i = v.begin(); i != v.end(); ++i)
-    {
+    b.AppendArray(v.data(), v.size());
+}
+
+template <typename T>
+inline void AppendElements(ByteBuffer &b, std::vector<T> const& v, std::false_type)
+{
+    for (typename std::vector<T>::const_iterator i = v.begin(); i != v.end(); ++i)
         b << *i;
-    }
-    return b;
 }
 
 template <typename T>
-inline ByteBuffer &operator>>(ByteBuffer &b, std::vector<T> &v)
+inline void ReadElements(ByteBuffer &b, std::vector<T> &v, uint32 vsize, std::true_type)
+{
+    // don't let a bogus count allocate more than the packet could hold
+    if (!b.CheckRead(b.rpos(), size_t(vsize) * sizeof(T)))
+        return;
+
+    v.resize(vsize);
+    b.ReadArray(v.data(), vsize);
+}
+
+template <typename T>
+inline void ReadElements(ByteBuffer &b, std::vector<T> &v, uint32 vsize, std::false_type)
 {
-    uint32 vsize;
-    b >> vsize;
-    v.clear();
     while (vsize--)
     {
         T t;
         b >> t;
         v.push_back(t);
     }
+}
+
+template <typename T>
+inline ByteBuffer &operator<<(ByteBuffer &b, std::vector<T> const& v)
+{
+    b << (uint32)v.size();
+    AppendElements(b, v, IsBulkSerializable<T>());
+    return b;
+}
+
+template <typename T>
+inline ByteBuffer &operator>>(ByteBuffer &b, std::vector<T> &v)
+{
+    uint32 vsize;
+    b >> vsize;
+    v.clear();
+    ReadElements(b, v, vsize, IsBulkSerializable<T>());
     return b;
 }
 
 template <typename T>
-inline ByteBuffer &operator<<(ByteBuffer &b, std::list<T> v)
+inline ByteBuffer &operator<<(ByteBuffer &b, std::list<T> const& v)
 {
     b << (uint32)v.size();
-    for (typename std::list<T>::iterator i = v.begin(); i != v.end(); ++i)
+    for (typename std::list<T>::const_iterator i = v.begin(); i != v.end(); ++i)
     {
         b << *i;
     }
@@ -747,10 +1108,10 @@ inline ByteBuffer &operator>>(ByteBuffer &b, std::list<T> &v)
 }
 
 template <typename K, typename V>
-inline ByteBuffer &operator<<(ByteBuffer &b, std::map<K, V> &m)
+inline ByteBuffer &operator<<(ByteBuffer &b, std::map<K, V> const& m)
 {
     b << (uint32)m.size();
-    for (typename std::map<K, V>::iterator i = m.begin(); i != m.end(); ++i)
+    for (typename std::map<K, V>::const_iterator i = m.begin(); i != m.end(); ++i)
     {
         b << i->first << i->second;
     }
@@ -773,6 +1134,62 @@ inline ByteBuffer &operator>>(ByteBuffer &b, std::map<K, V> &m)
     return b;
 }
 
+/**
+  * Selects LEB128 encoding for a single field, zigzag for signed types:
+  *     data << AsVarInt(count);
+  *     data >> AsVarInt(count);
+*/
+template <typename T>
+struct VarIntField
+{
+    explicit VarIntField(T& value) : Value(value) { }
+    T& Value;
+};
+
+template <typename T>
+inline VarIntField<T> AsVarInt(T& value) { return VarIntField<T>(value); }
+
+template <typename T>
+inline VarIntField<T const> AsVarInt(T const& value) { return VarIntField<T const>(value); }
+
+template <typename T>
+inline ByteBuffer &operator<<(ByteBuffer &b, VarIntField<T> const& field)
+{
+    static_assert(std::is_integral<T>::value, "AsVarInt(non-integer)");
+    if (std::is_signed<T>::value)
+        b.AppendVarInt(int64(field.Value));
+    else
+        b.AppendVarUInt(uint64(field.Value));
+    return b;
+}
+
+template <typename T>
+inline ByteBuffer &operator>>(ByteBuffer &b, VarIntField<T> const& field)
+{
+    static_assert(std::is_integral<T>::value && !std::is_const<T>::value, "AsVarInt(non-integer)");
+    if (std::is_signed<T>::value)
+    {
+        int64 value = b.ReadVarInt();
+        if (value < int64(std::numeric_limits<T>::min()) || value > int64(std::numeric_limits<T>::max()))
+        {
+            b.ValueFailed();
+            value = 0;
+        }
+        field.Value = T(value);
+    }
+    else
+    {
+        uint64 value = b.ReadVarUInt();
+        if (value > uint64(std::numeric_limits<T>::max()))
+        {
+            b.ValueFailed();
+            value = 0;
+        }
+        field.Value = T(value);
+    }
+    return b;
+}
+
 /// @todo Make a ByteBuffer.cpp and move all this inlining to it.
 template<> inline std::string ByteBuffer::read<std::string>()
 {
@@ -0,0 +1,208 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _BYTEBUFFERSTORAGE_H
+#define _BYTEBUFFERSTORAGE_H
+
+#include "Define.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+/**
+  * Byte storage used by ByteBuffer and MessageBuffer.
+  * Keeps up to INLINE_SIZE bytes inside the object and only spills to the heap
+  * once the contents outgrow it, so small packets never allocate.
+  * Growth is geometric and resize_uninitialized() leaves new bytes unset, for
+  * callers that are about to overwrite them anyway.
+  * Room can be kept in front of the contents (reserve_headroom) so a header can be
+  * prepended later without moving the contents (claim_headroom).
+*/
+class ByteBufferStorage
+{
+    public:
+        static size_t const INLINE_SIZE = 64;
+
+        ByteBufferStorage() : _data(_buffer), _head(0), _size(0), _capacity(INLINE_SIZE) { }
+
+        ByteBufferStorage(ByteBufferStorage const& right) : _data(_buffer), _head(0), _size(0), _capacity(INLINE_SIZE)
+        {
+            assign(right);
+        }
+
+        ByteBufferStorage(ByteBufferStorage&& right) : _data(_buffer), _head(0), _size(0), _capacity(INLINE_SIZE)
+        {
+            steal(right);
+        }
+
+        ~ByteBufferStorage()
+        {
+            if (!is_inline())
+                std::free(_data);
+        }
+
+        ByteBufferStorage& operator=(ByteBufferStorage const& right)
+        {
+            if (this != &right)
+                assign(right);
+
+            return *this;
+        }
+
+        ByteBufferStorage& operator=(ByteBufferStorage&& right)
+        {
+            if (this != &right)
+            {
+                if (!is_inline())
+                    std::free(_data);
+
+                _data = _buffer;
+                _head = 0;
+                _size = 0;
+                _capacity = INLINE_SIZE;
+                steal(right);
+            }
+
+            return *this;
+        }
+
+        uint8* data() { return _data + _head; }
+        uint8 const* data() const { return _data + _head; }
+
+        size_t size() const { return _size; }
+        size_t capacity() const { return _capacity - _head; }
+        bool empty() const { return _size == 0; }
+
+        /// True while the contents still live in the in-object buffer
+        bool is_inline() const { return _data == _buffer; }
+
+        uint8& operator[](size_t pos) { return data()[pos]; }
+        uint8 const& operator[](size_t pos) const { return data()[pos]; }
+
+        void reserve(size_t newCapacity)
+        {
+            if (newCapacity > capacity())
+                reallocate(_head + newCapacity);
+        }
+
+        /// Keeps bytes free in front of the contents, only valid while empty
+        void reserve_headroom(size_t bytes)
+        {
+            if (_size)
+                return;
+
+            if (bytes > _capacity)
+                reallocate(bytes);
+
+            _head = bytes;
+        }
+
+        size_t headroom() const { return _head; }
+
+        /// Makes the last bytes of the headroom part of the contents and returns a pointer to them
+        uint8* claim_headroom(size_t bytes)
+        {
+            _head -= bytes;
+            _size += bytes;
+            return data();
+        }
+
+        // new bytes are zeroed, same as std::vector
+        void resize(size_t newSize)
+        {
+            size_t oldSize = _size;
+            resize_uninitialized(newSize);
+            if (newSize > oldSize)
+                std::memset(data() + oldSize, 0, newSize - oldSize);
+        }
+
+        // new bytes are left as they are, the caller is expected to fill them
+        void resize_uninitialized(size_t newSize)
+        {
+            if (_head + newSize > _capacity)
+                reallocate(_head + newSize > _capacity * 2 ? _head + newSize : _capacity * 2);
+
+            _size = newSize;
+        }
+
+        // keeps the heap block (if any) for reuse, same as std::vector
+        void clear()
+        {
+            _head = 0;
+            _size = 0;
+        }
+
+    private:
+        void reallocate(size_t newCapacity)
+        {
+            uint8* newData;
+            if (is_inline())
+            {
+                newData = static_cast<uint8*>(std::malloc(newCapacity));
+                if (newData && _head + _size)
+                    std::memcpy(newData, _buffer, _head + _size);
+            }
+            else
+                newData = static_cast<uint8*>(std::realloc(_data, newCapacity));
+
+            if (!newData)
+                throw std::bad_alloc();
+
+            _data = newData;
+            _capacity = newCapacity;
+        }
+
+        void assign(ByteBufferStorage const& right)
+        {
+            _head = 0;
+            _size = 0;
+            reserve(right._head + right._size);
+            if (right._head + right._size)
+                std::memcpy(_data, right._data, right._head + right._size);
+            _head = right._head;
+            _size = right._size;
+        }
+
+        // expects this to be empty and inline
+        void steal(ByteBufferStorage& right)
+        {
+            if (right.is_inline())
+            {
+                if (right._head + right._size)
+                    std::memcpy(_buffer, right._buffer, right._head + right._size);
+            }
+            else
+            {
+                _data = right._data;
+                _capacity = right._capacity;
+            }
+
+            _head = right._head;
+            _size = right._size;
+            right._data = right._buffer;
+            right._head = 0;
+            right._size = 0;
+            right._capacity = INLINE_SIZE;
+        }
+
+        uint8* _data;
+        size_t _head;                                       // headroom in front of the contents
+        size_t _size;
+        size_t _capacity;
+        uint8 _buffer[INLINE_SIZE];
+};
+
+#endif
@@ -19,12 +19,12 @@
 
 MessageBuffer::MessageBuffer() : _wpos(0), _rpos(0), _storage()
 {
-    _storage.resize(4096);
+    _storage.resize_uninitialized(4096);
 }
 
 MessageBuffer::MessageBuffer(std::size_t initialSize) : _wpos(0), _rpos(0), _storage()
 {
-    _storage.resize(initialSize);
+    _storage.resize_uninitialized(initialSize);
 }
 
 MessageBuffer::MessageBuffer(MessageBuffer const& right) : _wpos(right._wpos), _rpos(right._rpos), _storage(right._storage)
@@ -32,3 +32,5 @@ MessageBuffer::MessageBuffer(MessageBuffer const& right) : _wpos(right._wpos), _
 }
 
 MessageBuffer::MessageBuffer(MessageBuffer&& right) : _wpos(right._wpos), _rpos(right._rpos), _storage(right.Move()) { }
+
+MessageBuffer::MessageBuffer(ByteBufferStorage&& storage) : _wpos(storage.size()), _rpos(0), _storage(std::move(storage)) { }
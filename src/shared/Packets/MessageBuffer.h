@@ -17,17 +17,19 @@
 #define __MESSAGEBUFFER_H_
 
 #include "Define.h"
-#include <vector>
+#include "ByteBufferStorage.h"
 
 class MessageBuffer
 {
-    typedef std::vector<uint8>::size_type size_type;
+    typedef std::size_t size_type;
 
 public:
     MessageBuffer();
     explicit MessageBuffer(std::size_t initialSize);
     MessageBuffer(MessageBuffer const& right);
     MessageBuffer(MessageBuffer&& right);
+    // takes the whole storage as active data
+    explicit MessageBuffer(ByteBufferStorage&& storage);
 
     void Reset()
     {
@@ -35,9 +37,10 @@ public:
         _rpos = 0;
     }
 
+    // contents past the active data are not zeroed, they are always written before being read
     void Resize(size_type bytes)
     {
-        _storage.resize(bytes);
+        _storage.resize_uninitialized(bytes);
     }
 
     uint8* GetBasePointer() { return _storage.data(); }
@@ -73,7 +76,7 @@ public:
     {
         // resize buffer if it's already full
         if (GetRemainingSpace() == 0)
-            _storage.resize(_storage.size() * 3 / 2);
+            _storage.resize_uninitialized(_storage.size() * 3 / 2);
     }
 
     void Write(void const* data, std::size_t size)
@@ -85,7 +88,7 @@ public:
         }
     }
 
-    std::vector<uint8>&& Move()
+    ByteBufferStorage&& Move()
     {
         _wpos = 0;
         _rpos = 0;
@@ -119,7 +122,7 @@ public:
 private:
     size_type _wpos;
     size_type _rpos;
-    std::vector<uint8> _storage;
+    ByteBufferStorage _storage;
 };
 
 #endif /* __MESSAGEBUFFER_H_ */
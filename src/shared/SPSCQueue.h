@@ -0,0 +1,155 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include "Define.h"
+
+#include <atomic>
+#include <memory>
+
+/**
+  * Bounded lock-free queue for exactly one producer and one consumer thread at a time
+  * (a different thread may take over either side once the previous one is done with it,
+  * as long as something orders the two, e.g. the asio handler chain or a barrier).
+  *
+  * Both sides are wait-free. Each side keeps its own index on its own cache line plus a
+  * cached copy of the other side's index, so the shared line is only read when the cached
+  * copy says the queue looks full (producer) or empty (consumer).
+*/
+template <class T>
+class SPSCQueue
+{
+    static size_t const CACHE_LINE = 64;
+
+public:
+    //! capacity is rounded up to a power of two
+    explicit SPSCQueue(size_t capacity)
+    {
+        _consumer.index = 0;
+        _consumer.cached = 0;
+        _producer.index = 0;
+        _producer.cached = 0;
+
+        _capacity = 1;
+        while (_capacity < capacity)
+            _capacity <<= 1;
+
+        _mask = _capacity - 1;
+        _items.reset(new T[_capacity]);
+    }
+
+    //! Producer: adds an item, false when the queue is full.
+    bool add(T const& item)
+    {
+        size_t tail = _producer.index.load(std::memory_order_relaxed);
+        if (tail - _producer.cached == _capacity)
+        {
+            _producer.cached = _consumer.index.load(std::memory_order_acquire);
+            if (tail - _producer.cached == _capacity)
+                return false;
+        }
+
+        _items[tail & _mask] = item;
+        _producer.index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! Producer: true when add() would fail.
+    bool full()
+    {
+        size_t tail = _producer.index.load(std::memory_order_relaxed);
+        if (tail - _producer.cached == _capacity)
+            _producer.cached = _consumer.index.load(std::memory_order_acquire);
+
+        return tail - _producer.cached == _capacity;
+    }
+
+    //! Producer: how many items add() takes before the queue is full.
+    size_t available()
+    {
+        size_t tail = _producer.index.load(std::memory_order_relaxed);
+        _producer.cached = _consumer.index.load(std::memory_order_acquire);
+        return _capacity - (tail - _producer.cached);
+    }
+
+    //! Consumer: gets the next item, if any.
+    bool next(T& result)
+    {
+        size_t head = _consumer.index.load(std::memory_order_relaxed);
+        if (head == _consumer.cached)
+        {
+            _consumer.cached = _producer.index.load(std::memory_order_acquire);
+            if (head == _consumer.cached)
+                return false;
+        }
+
+        result = _items[head & _mask];
+        _consumer.index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+      * Consumer: hands the items present to fn(item) in order until fn returns false, the
+      * refused item stays first. The freed slots are given back to the producer once, at the end.
+      * Returns the number of items taken.
+    */
+    template <class Fn>
+    size_t drain(Fn&& fn)
+    {
+        size_t const first = _consumer.index.load(std::memory_order_relaxed);
+        _consumer.cached = _producer.index.load(std::memory_order_acquire);
+
+        size_t head = first;
+        while (head != _consumer.cached && fn(_items[head & _mask]))
+            ++head;
+
+        if (head != first)
+            _consumer.index.store(head, std::memory_order_release);
+
+        return head - first;
+    }
+
+    //! Consumer: true when nothing is queued.
+    bool empty()
+    {
+        return _consumer.index.load(std::memory_order_relaxed) == _producer.index.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return _capacity; }
+
+private:
+    size_t _capacity;
+    size_t _mask;
+    std::unique_ptr<T[]> _items;
+
+    // the index of one side plus its copy of the other side's index, padded onto a cache line of their own
+    struct Side
+    {
+        char before[CACHE_LINE];
+        std::atomic<size_t> index;                          // head for the consumer, tail for the producer
+        size_t cached;
+        char after[CACHE_LINE];
+    };
+
+    Side _consumer;
+    Side _producer;
+
+    SPSCQueue(SPSCQueue const& right) = delete;
+    SPSCQueue& operator=(SPSCQueue const& right) = delete;
+};
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SLOTMAP_H
+#define SLOTMAP_H
+
+#include "Define.h"
+
+#include <utility>
+#include <vector>
+
+/**
+  * Dense container with stable, generational handles.
+  * Values are kept back to back in insertion order (until an erase moves the last one into
+  * the hole), so iterating touches one contiguous array. A handle names a slot plus the
+  * generation of the slot when the value was inserted; once the value is erased the slot's
+  * generation moves on and the old handle no longer finds anything, even after the slot is reused.
+  *
+  * Erasing by dense index swaps the last value in, so a loop that erases must not advance:
+  *     for (size_t i = 0; i < map.size();)
+  *         if (dead(map[i])) map.EraseAt(i); else ++i;
+*/
+template <class T>
+class SlotMap
+{
+    public:
+        /// Slot index in the low 32 bits, generation in the high ones; 0 is never a valid handle
+        typedef uint64 Handle;
+
+        static Handle const INVALID_HANDLE = 0;
+
+        typedef typename std::vector<T>::iterator iterator;
+        typedef typename std::vector<T>::const_iterator const_iterator;
+
+        SlotMap() : _freeHead(NO_SLOT) { }
+
+        Handle Insert(T const& value)
+        {
+            uint32 slot;
+            if (_freeHead != NO_SLOT)
+            {
+                slot = _freeHead;
+                _freeHead = _slots[slot].index;
+            }
+            else
+            {
+                slot = uint32(_slots.size());
+                _slots.push_back(Slot());
+                _slots[slot].generation = 1;
+            }
+
+            _slots[slot].index = uint32(_values.size());
+            _values.push_back(value);
+            _valueSlots.push_back(slot);
+            return MakeHandle(slot, _slots[slot].generation);
+        }
+
+        /// nullptr when the value of handle was erased
+        T* Find(Handle handle)
+        {
+            uint32 slot = uint32(handle);
+            if (slot >= _slots.size() || _slots[slot].generation != uint32(handle >> 32))
+                return nullptr;
+
+            return &_values[_slots[slot].index];
+        }
+
+        T const* Find(Handle handle) const
+        {
+            return const_cast<SlotMap*>(this)->Find(handle);
+        }
+
+        bool Erase(Handle handle)
+        {
+            uint32 slot = uint32(handle);
+            if (slot >= _slots.size() || _slots[slot].generation != uint32(handle >> 32))
+                return false;
+
+            EraseAt(_slots[slot].index);
+            return true;
+        }
+
+        /// Erases the value at dense position index, the last value takes its place
+        void EraseAt(size_t index)
+        {
+            uint32 slot = _valueSlots[index];
+            size_t last = _values.size() - 1;
+            if (index != last)
+            {
+                _values[index] = std::move(_values[last]);
+                _valueSlots[index] = _valueSlots[last];
+                _slots[_valueSlots[index]].index = uint32(index);
+            }
+
+            _values.pop_back();
+            _valueSlots.pop_back();
+
+            // generation 0 is skipped so no handle is ever 0
+            if (!++_slots[slot].generation)
+                _slots[slot].generation = 1;
+            _slots[slot].index = _freeHead;
+            _freeHead = slot;
+        }
+
+        /// Handle of the value at dense position index
+        Handle GetHandle(size_t index) const
+        {
+            uint32 slot = _valueSlots[index];
+            return MakeHandle(slot, _slots[slot].generation);
+        }
+
+        T& operator[](size_t index) { return _values[index]; }
+        T const& operator[](size_t index) const { return _values[index]; }
+
+        iterator begin() { return _values.begin(); }
+        iterator end() { return _values.end(); }
+        const_iterator begin() const { return _values.begin(); }
+        const_iterator end() const { return _values.end(); }
+
+        size_t size() const { return _values.size(); }
+        bool empty() const { return _values.empty(); }
+
+        void reserve(size_t count)
+        {
+            _values.reserve(count);
+            _valueSlots.reserve(count);
+            _slots.reserve(count);
+        }
+
+    private:
+        static uint32 const NO_SLOT = 0xFFFFFFFF;
+
+        struct Slot
+        {
+            uint32 index;                                   // dense position, or next free slot
+            uint32 generation;
+        };
+
+        static Handle MakeHandle(uint32 slot, uint32 generation)
+        {
+            return (Handle(generation) << 32) | slot;
+        }
+
+        std::vector<T> _values;
+        std::vector<uint32> _valueSlots;                    // slot of each value, parallel to _values
+        std::vector<Slot> _slots;
+        uint32 _freeHead;
+};
+
+#endif
@@ -21,11 +21,23 @@
 
 using namespace std::chrono;
 
+// steady_clock never jumps with the wall clock (NTP, DST, an admin setting the date), tick diffs stay sane
+inline steady_clock::time_point GetApplicationStartTime()
+{
+    static const steady_clock::time_point ApplicationStartTime = steady_clock::now();
+
+    return ApplicationStartTime;
+}
+
 inline uint32 getMSTime()
 {
-    static const system_clock::time_point ApplicationStartTime = system_clock::now();
+    return uint32(duration_cast<milliseconds>(steady_clock::now() - GetApplicationStartTime()).count());
+}
 
-    return uint32(duration_cast<milliseconds>(system_clock::now() - ApplicationStartTime).count());
+/// Nanoseconds since start, for measuring; does not wrap for centuries
+inline uint64 getNSTime()
+{
+    return uint64(duration_cast<nanoseconds>(steady_clock::now() - GetApplicationStartTime()).count());
 }
 
 inline uint32 getMSTimeDiff(uint32 oldMSTime, uint32 newMSTime)
@@ -0,0 +1,97 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(size_t threads) : _generation(0), _busyWorkers(0), _stopped(false), _task(nullptr), _count(0), _next(0)
+{
+    _threads.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+        _threads.push_back(std::thread(&WorkerPool::WorkerMain, this));
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _stopped = true;
+    }
+
+    _start.notify_all();
+    for (std::thread& thread : _threads)
+        thread.join();
+}
+
+void WorkerPool::Run(size_t count, Task const& task)
+{
+    if (!count)
+        return;
+
+    // not worth waking anyone for
+    if (_threads.empty() || count == 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+            task(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _task = &task;
+        _count = count;
+        _next.store(0, std::memory_order_relaxed);
+        _busyWorkers = _threads.size();
+        ++_generation;
+    }
+
+    _start.notify_all();
+    Work();
+
+    std::unique_lock<std::mutex> guard(_lock);
+    while (_busyWorkers)
+        _done.wait(guard);
+
+    _task = nullptr;
+}
+
+void WorkerPool::WorkerMain()
+{
+    uint64 generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+            while (!_stopped && _generation == generation)
+                _start.wait(guard);
+
+            if (_stopped)
+                return;
+
+            generation = _generation;
+        }
+
+        Work();
+
+        std::lock_guard<std::mutex> guard(_lock);
+        if (!--_busyWorkers)
+            _done.notify_one();
+    }
+}
+
+void WorkerPool::Work()
+{
+    for (size_t i = _next.fetch_add(1, std::memory_order_relaxed); i < _count; i = _next.fetch_add(1, std::memory_order_relaxed))
+        (*_task)(i);
+}
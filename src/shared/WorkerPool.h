@@ -0,0 +1,70 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include "Define.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+  * Fixed set of threads that run the tasks of one batch at a time.
+  * Run() hands out task indexes one by one from a shared counter, so a worker that is
+  * done with a cheap task simply takes the next one and slow tasks do not hold up the rest.
+  * The calling thread works along and Run() only returns once every task has finished,
+  * which makes it a barrier between the batch and whatever comes after it.
+*/
+class WorkerPool
+{
+    public:
+        typedef std::function<void(size_t)> Task;
+
+        /// threads is the number of extra threads, 0 runs every batch on the calling thread
+        explicit WorkerPool(size_t threads);
+        ~WorkerPool();
+
+        /// Calls task(i) for every i in [0, count) and waits for all of them
+        void Run(size_t count, Task const& task);
+
+        size_t GetThreadCount() const { return _threads.size(); }
+
+    private:
+        void WorkerMain();
+        void Work();
+
+        std::vector<std::thread> _threads;
+
+        std::mutex _lock;
+        std::condition_variable _start;
+        std::condition_variable _done;
+        uint64 _generation;                                 // bumped for every batch
+        size_t _busyWorkers;
+        bool _stopped;
+
+        Task const* _task;
+        size_t _count;
+        std::atomic<size_t> _next;
+
+        WorkerPool(WorkerPool const& right) = delete;
+        WorkerPool& operator=(WorkerPool const& right) = delete;
+};
+
+#endif
@@ -19,6 +19,11 @@
 #include "Socket.h"
 #include "Timer.h"
 #include "Server.h"
+#include "PacketDump.h"
+#include "OpcodeStats.h"
+#include "PacketPool.h"
+#include "Log.h"
+#include "MetricsServer.h"
 #include "Database/DatabaseEnv.h"
 
 #include <boost/asio/io_service.hpp>
@@ -27,10 +32,22 @@
 boost::asio::io_service _ioService;
 
 #define SERVER_SLEEP_CONST 50
+// low-latency mode: the world loop wakes as soon as packets arrive, but no more often than every SERVER_MIN_TICK ms
+#define SERVER_LOW_LATENCY 1
+#define SERVER_MIN_TICK 5
+// ticks taking longer are logged with their phase breakdown
+#define SERVER_SLOW_TICK 100
 #define PORT 8085
 #define THREAD_POOL 6
-
-MySQLConnection Database;
+#define SESSION_UPDATE_THREADS 3
+// per session and tick: packet cost units (see opcodeTable) and microseconds in handlers
+#define SESSION_PACKET_BUDGET 64
+#define SESSION_TIME_BUDGET 2000
+// Prometheus text format on http://METRICS_BIND:METRICS_PORT/metrics, 0 disables
+#define METRICS_BIND "127.0.0.1"
+#define METRICS_PORT 9464
+// connections of the database worker pool, each with a thread of its own
+#define DATABASE_WORKERS 2
 
 void ServerUpdateLoop()
 {
@@ -50,7 +67,15 @@ void ServerUpdateLoop()
         sServer->Update(diff);
         realPrevTime = realCurrTime;
 
-        if (diff <= SERVER_SLEEP_CONST + prevSleepTime)
+        if (SERVER_LOW_LATENCY)
+        {
+            // measured from the start of this tick, so a long update waits less
+            uint32 updateTime = GetMSTimeDiffToNow(realCurrTime);
+            uint32 minWait = updateTime < SERVER_MIN_TICK ? SERVER_MIN_TICK - updateTime : 0;
+            uint32 maxWait = updateTime < SERVER_SLEEP_CONST ? SERVER_SLEEP_CONST - updateTime : 0;
+            sServer->WaitForInput(minWait, maxWait);
+        }
+        else if (diff <= SERVER_SLEEP_CONST + prevSleepTime)
         {
             prevSleepTime = SERVER_SLEEP_CONST + prevSleepTime - diff;
             std::this_thread::sleep_for(std::chrono::milliseconds(prevSleepTime));
@@ -70,11 +95,15 @@ void ShutdownThreadPool(std::vector<std::thread>& threadPool)
 
 int main(int argc, char** argv)
 {
-	std::cout << "Ships: Start server" << std::endl;
+    sLog->Start();
+    LOG_INFO("server", "Ships: Start server");
 
-    if (!Database.Open(MySQLConnectionInfo("localhost", "3036", "ships", "root", "root")))
+    // callbacks are run by the next tick, in low-latency mode that one starts right away
+    if (!Database.Open(MySQLConnectionInfo("localhost", "3036", "ships", "root", "root"), DATABASE_WORKERS, []() { sServer->SignalInput(); }))
         return 0;
 
+    sPacketDump->Start();
+
     // Start the Boost based thread pool
     int numThreads = THREAD_POOL;
     std::vector<std::thread> threadPool;
@@ -83,13 +112,45 @@ int main(int argc, char** argv)
 
     sSocketMgr.StartNetwork(_ioService, "0.0.0.0", PORT, 1);
 
+    std::unique_ptr<MetricsServer> metricsServer;
+    if (METRICS_PORT)
+    {
+        try
+        {
+            metricsServer.reset(new MetricsServer(_ioService, METRICS_BIND, METRICS_PORT));
+            metricsServer->Start();
+            sServer->RegisterMetrics();
+        }
+        catch (boost::system::system_error const& err)
+        {
+            LOG_ERROR("metrics", "Could not serve metrics on {}:{}: {}", METRICS_BIND, METRICS_PORT, err.what());
+        }
+    }
+
     for (int i = 0; i < numThreads; ++i)
         threadPool.push_back(std::thread(boost::bind(&boost::asio::io_service::run, &_ioService)));
 
+    sServer->GetTickProfiler().SetSlowTickThreshold(SERVER_SLOW_TICK);
+    sServer->SetSessionBudget(SessionBudget(SESSION_PACKET_BUDGET, SESSION_TIME_BUDGET));
+    sServer->SetUpdateThreads(SESSION_UPDATE_THREADS);
+
     ServerUpdateLoop();
 
+    sServer->SetUpdateThreads(0);
+
+    // the last callbacks run here, while sessions, network and log are still up
+    Database.Close();
+
+    if (metricsServer)
+        metricsServer->Close();
+
     ShutdownThreadPool(threadPool);
     sSocketMgr.StopNetwork();
-    Database.Close();
+    sPacketDump->Stop();
+
+    sOpcodeStats->Dump(std::cout);
+    sServer->GetTickProfiler().Dump(std::cout);
+    std::cout << "Packet pool: " << PacketPool::GetAllocationCount() << " packets allocated, " << PacketPool::GetRecycleCount() << " recycled" << std::endl;
+    sLog->Stop();
     return 0;
 }